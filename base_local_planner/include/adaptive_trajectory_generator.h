@@ -0,0 +1,190 @@
+/*********************************************************************
+ *
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2017, Open Source Robotics Foundation, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Author: Jeeseon Kim
+ *********************************************************************/
+
+#ifndef ADAPTIVE_TRAJECTORY_GENERATOR_H
+#define ADAPTIVE_TRAJECTORY_GENERATOR_H
+
+#include <base_local_planner/simple_trajectory_generator.h>
+#include <map>
+#include <set>
+#include <vector>
+#include <Eigen/Core>
+
+namespace base_local_planner {
+
+/**
+ * SimpleTrajectoryGenerator that can sample coarse to fine. It is initialised
+ * with a coarse grid like its base class; refineAround() replaces the samples
+ * with small local grids around given velocities, within the same dynamic
+ * window, and resumeGrid() goes back to the coarse grid. No velocity is
+ * handed out twice between two calls of initialise().
+ *
+ * In dwa mode a rollout only depends on the sampled velocity and the
+ * simulation parameters, not on the robot velocity, so it can be cached in
+ * the robot frame and moved to the current pose with one rigid transform per
+ * point. With a rollout cache the samples are snapped to a velocity lattice
+ * so that the same rollouts come up again in later cycles; a rollout for a
+ * negative rotational velocity is the mirror image of the positive one.
+ */
+class AdaptiveTrajectoryGenerator: public SimpleTrajectoryGenerator {
+public:
+
+  AdaptiveTrajectoryGenerator() : spread_order_(false), cache_resolution_(0.0) {}
+  ~AdaptiveTrajectoryGenerator() {}
+
+  /**
+   * Same as SimpleTrajectoryGenerator::setParameters(), also clears the rollout cache
+   */
+  void setParameters(double sim_time,
+      double sim_granularity,
+      double angular_sim_granularity,
+      bool use_dwa = false,
+      double sim_period = 0.0);
+
+  /**
+   * Cache robot frame rollouts on a velocity lattice, only used in dwa mode
+   * @param resolution The lattice spacing in m/s and rad/s, 0 disables the cache
+   */
+  void setRolloutCache(double resolution);
+
+  /**
+   * Hand out the grid in coarse to fine order instead of row by row: first
+   * a sparse subgrid spanning the whole window, then the samples halving its
+   * spacing, and so on. Any prefix of the samples then covers the window
+   * evenly, which matters when scoring may stop early.
+   */
+  void setSpreadOrder(bool spread_order) { spread_order_ = spread_order; }
+
+  /**
+   * Same as SimpleTrajectoryGenerator::initialise(), also records the grid
+   * and the velocity window it spans for later refinement
+   */
+  void initialise(
+      const Eigen::Vector3f& pos,
+      const Eigen::Vector3f& vel,
+      const Eigen::Vector3f& goal,
+      base_local_planner::LocalPlannerLimits* limits,
+      const Eigen::Vector3f& vsamples,
+      bool discretize_by_time = false);
+
+  /**
+   * Replace the samples with a local grid around each seed velocity. Each
+   * grid spans one coarse step to either side in every dimension, clamped to
+   * the velocity window of the last initialise(). Velocities that were
+   * already handed out since then are left out.
+   * @param seeds The velocities to refine around, best first
+   * @param fine_samples The number of samples per dimension of each local grid
+   */
+  void refineAround(const std::vector<Eigen::Vector3f>& seeds, int fine_samples);
+
+  /**
+   * Replace the samples with those of the grid of the last initialise() that
+   * were not handed out yet
+   * @param fraction The part of those samples to keep, spread over the window:
+   * a prefix in spread order, evenly spaced samples otherwise
+   */
+  void resumeGrid(double fraction = 1.0);
+
+  bool nextTrajectory(Trajectory &traj);
+
+  /**
+   * Same as SimpleTrajectoryGenerator::generateTrajectory(), taken from the
+   * rollout cache for velocities on the lattice
+   */
+  bool generateTrajectory(
+      Eigen::Vector3f pos,
+      Eigen::Vector3f vel,
+      Eigen::Vector3f sample_target_vel,
+      base_local_planner::Trajectory& traj);
+
+  /**
+   * The number of samples of the current grid
+   */
+  unsigned int getNumSamples() const { return sample_params_.size(); }
+
+private:
+
+  struct VelocityLess {
+    bool operator()(const Eigen::Vector3f& a, const Eigen::Vector3f& b) const {
+      if (a[0] != b[0]) return a[0] < b[0];
+      if (a[1] != b[1]) return a[1] < b[1];
+      return a[2] < b[2];
+    }
+  };
+
+  /**
+   * A rollout from the origin, for a velocity with a non-negative rotational component
+   */
+  struct Rollout {
+    bool valid;
+    double time_delta;
+    std::vector<float> x, y, th;
+  };
+
+  struct RolloutKey {
+    int vx, vy, vth;
+    bool discretize_by_time;
+    bool operator<(const RolloutKey& other) const {
+      if (vx != other.vx) return vx < other.vx;
+      if (vy != other.vy) return vy < other.vy;
+      if (vth != other.vth) return vth < other.vth;
+      return discretize_by_time < other.discretize_by_time;
+    }
+  };
+
+  void sortBySpread();
+
+  /**
+   * Move vel_samp to the nearest lattice point inside the velocity window, false if there is none
+   */
+  bool snapToLattice(Eigen::Vector3f& vel_samp) const;
+
+  /**
+   * Replace the samples with their lattice points, keeping the order and dropping duplicates
+   */
+  void snapSamples();
+
+  bool spread_order_;
+  double cache_resolution_;
+  std::map<RolloutKey, Rollout> rollouts_;
+  Eigen::Vector3f min_vel_, max_vel_, coarse_step_;
+  std::vector<Eigen::Vector3f> grid_;
+  std::set<Eigen::Vector3f, VelocityLess> sampled_;
+};
+
+} /* namespace base_local_planner */
+#endif /* ADAPTIVE_TRAJECTORY_GENERATOR_H */
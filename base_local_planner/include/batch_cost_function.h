@@ -0,0 +1,87 @@
+/*********************************************************************
+ *
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2017, Open Source Robotics Foundation, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Author: Jeeseon Kim
+ *********************************************************************/
+
+#ifndef BATCH_COST_FUNCTION_H
+#define BATCH_COST_FUNCTION_H
+
+#include <base_local_planner/trajectory_cost_function.h>
+#include <vector>
+
+namespace base_local_planner {
+
+/**
+ * Interface for critics that can score many sampled trajectories in one call,
+ * keeping costmap and map grid lookups of consecutive trajectories together.
+ */
+class BatchCostFunction {
+public:
+
+  virtual ~BatchCostFunction() {}
+
+  /**
+   * Score trajs[indices[k]] for every k and write its cost to costs[k]. The
+   * costs have the same meaning as those of TrajectoryCostFunction::scoreTrajectory(),
+   * they are not scaled and negative values reject the trajectory.
+   */
+  virtual void scoreTrajectories(std::vector<Trajectory>& trajs,
+      const std::vector<unsigned int>& indices, std::vector<double>& costs) = 0;
+};
+
+/**
+ * Fallback that scores the trajectories of a batch one by one with a
+ * single-trajectory critic.
+ */
+class BatchCostFunctionAdapter: public BatchCostFunction {
+public:
+
+  BatchCostFunctionAdapter(TrajectoryCostFunction* critic) : critic_(critic) {}
+
+  void scoreTrajectories(std::vector<Trajectory>& trajs,
+      const std::vector<unsigned int>& indices, std::vector<double>& costs) {
+    costs.resize(indices.size());
+    for (unsigned int k = 0; k < indices.size(); ++k) {
+      costs[k] = critic_->scoreTrajectory(trajs[indices[k]]);
+    }
+  }
+
+private:
+
+  TrajectoryCostFunction* critic_;
+};
+
+} /* namespace base_local_planner */
+#endif /* BATCH_COST_FUNCTION_H */
@@ -0,0 +1,143 @@
+/*********************************************************************
+ *
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2017, Open Source Robotics Foundation, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Author: Jeeseon Kim
+ *********************************************************************/
+
+#ifndef BATCH_MAP_GRID_COST_FUNCTION_H
+#define BATCH_MAP_GRID_COST_FUNCTION_H
+
+#include <base_local_planner/map_grid_cost_function.h>
+#include <base_local_planner/batch_cost_function.h>
+#include <base_local_planner/bounded_cost_function.h>
+#include <base_local_planner/map_grid_engine.h>
+
+namespace base_local_planner {
+
+/**
+ * MapGridCostFunction that can also score a batch of trajectories. The map
+ * geometry and the scoring options are read once per batch instead of once
+ * per trajectory point.
+ *
+ * Without an engine the grid is propagated and scored by a wrapped
+ * MapGridCostFunction, the scoring options are kept here and passed on to it.
+ *
+ * With a MapGridEngine, prepare() takes the grid of the engine for the
+ * target poses instead of propagating its own, so cost functions with the
+ * same targets share a single propagation.
+ *
+ * The map geometry is read in prepare(), so that trajectories are looked up
+ * in the grid as it was computed even if the costmap moves meanwhile.
+ */
+class BatchMapGridCostFunction: public TrajectoryCostFunction, public BatchCostFunction, public BoundedCostFunction {
+public:
+
+  BatchMapGridCostFunction(costmap_2d::Costmap2D* costmap,
+      double xshift = 0.0,
+      double yshift = 0.0,
+      bool is_local_goal_function = false,
+      CostAggregationType aggregationType = Last);
+
+  ~BatchMapGridCostFunction() {}
+
+  /**
+   * Take the grids from engine, NULL to propagate its own
+   */
+  void setEngine(MapGridEngine* engine);
+
+  void setTargetPoses(std::vector<geometry_msgs::PoseStamped> target_poses);
+
+  bool prepare();
+
+  double scoreTrajectory(Trajectory &traj);
+
+  /**
+   * Same as MapGridCostFunction::getCellCosts(), from the grid of the engine if there is one
+   */
+  double getCellCosts(unsigned int cx, unsigned int cy) {
+    return layer_ != NULL ? layer_->getCellCosts(cx, cy) : grid_costs_.getCellCosts(cx, cy);
+  }
+  double obstacleCosts() { return layer_ != NULL ? layer_->obstacleCosts() : grid_costs_.obstacleCosts(); }
+  double unreachableCellCosts() { return layer_ != NULL ? layer_->unreachableCellCosts() : grid_costs_.unreachableCellCosts(); }
+
+  void setXShift(double xshift);
+  void setYShift(double yshift);
+  void setStopOnFailure(bool stop_on_failure);
+
+  double getXShift() const { return xshift_; }
+  double getYShift() const { return yshift_; }
+  bool getStopOnFailure() const { return stop_on_failure_; }
+  CostAggregationType getAggregationType() const { return aggregationType_; }
+
+  void scoreTrajectories(std::vector<Trajectory>& trajs,
+      const std::vector<unsigned int>& indices, std::vector<double>& costs);
+
+  /**
+   * Grid value at the (shifted) end point. Exact for Last aggregation and a
+   * lower bound for Sum, Product gets 0.
+   */
+  double costLowerBound(Trajectory &traj);
+
+private:
+
+  /**
+   * The map geometry and grid constants, read once per batch
+   */
+  struct GridGeometry {
+    double origin_x, origin_y, resolution;
+    unsigned int size_x, size_y;
+    double obstacle_costs, unreachable_costs;
+  };
+
+  GridGeometry getGeometry();
+
+  double trajectoryCost(Trajectory &traj, const GridGeometry& geometry);
+
+  // scores without an engine
+  MapGridCostFunction grid_costs_;
+  costmap_2d::Costmap2D* costmap_;
+  MapGridEngine* engine_;
+  const CompactMapGrid* layer_;
+  // of the costmap at the last prepare()
+  GridGeometry geometry_;
+  std::vector<geometry_msgs::PoseStamped> target_poses_;
+  bool is_local_goal_function_;
+  CostAggregationType aggregationType_;
+  double xshift_;
+  double yshift_;
+  bool stop_on_failure_;
+};
+
+} /* namespace base_local_planner */
+#endif /* BATCH_MAP_GRID_COST_FUNCTION_H */
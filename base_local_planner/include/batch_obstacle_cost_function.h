@@ -0,0 +1,235 @@
+/*********************************************************************
+ *
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2017, Open Source Robotics Foundation, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Author: Jeeseon Kim
+ *********************************************************************/
+
+#ifndef BATCH_OBSTACLE_COST_FUNCTION_H
+#define BATCH_OBSTACLE_COST_FUNCTION_H
+
+#include <base_local_planner/obstacle_cost_function.h>
+#include <base_local_planner/batch_cost_function.h>
+#include <base_local_planner/bounded_cost_function.h>
+#include <base_local_planner/costmap_model.h>
+#include <base_local_planner/costmap_snapshot.h>
+#include <base_local_planner/costmap_pyramid.h>
+#include <base_local_planner/distance_field.h>
+#include <map>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace base_local_planner {
+
+/**
+ * ObstacleCostFunction that can also score a batch of trajectories. The
+ * footprint radii are computed once when the footprint is set instead of for
+ * every trajectory point, and the footprint is no longer copied per point.
+ *
+ * With the stencil cache, the footprint cells swept by a trajectory are
+ * rasterized once per sampled velocity and start heading, in 64 bins, and
+ * kept as offsets from the start cell. Scoring a trajectory is then a single
+ * pass over its stencil, and as the heading stays in its bin over several
+ * cycles, so does the stencil. This only holds when the rollout depends on
+ * the sampled velocity alone, as in dwa mode, and only for the max of the
+ * pose costs. Stencils are dilated by the error of the quantized heading and
+ * of the position within the start cell, so they cover the exact footprint
+ * cells of every start pose in their bin and their cost is never below the
+ * exact one. When a stencil cannot rule out a failure, the trajectory is
+ * checked pose by pose.
+ *
+ * With distance fields, computed once per cycle in prepare(), a pose is
+ * accepted at no cost without a footprint check when the nearest cell with
+ * any cost is farther than the circumscribed radius, and rejected when a
+ * lethal or unknown cell is closer than the inscribed radius. The rejection
+ * is stricter than the footprint check, which only looks at the footprint
+ * outline and the center cell and so misses obstacles fully inside it.
+ *
+ * With a costmap pyramid, built once per cycle in prepare(), a pose is
+ * skipped without a footprint check when no cell within reach of its
+ * footprint costs more than the trajectory already does, so it can neither
+ * fail nor change the cost. The costs are the same as without it.
+ *
+ * With a CostmapSnapshot, trajectories are scored against the snapshot
+ * instead of the costmap. The snapshot is to be taken along with prepare().
+ */
+class BatchObstacleCostFunction: public ObstacleCostFunction, public BatchCostFunction, public BoundedCostFunction {
+public:
+
+  BatchObstacleCostFunction(costmap_2d::Costmap2D* costmap);
+  ~BatchObstacleCostFunction();
+
+  /**
+   * Recompute the distance fields when they are enabled
+   */
+  bool prepare();
+
+  double scoreTrajectory(Trajectory &traj);
+
+  void scoreTrajectories(std::vector<Trajectory>& trajs,
+      const std::vector<unsigned int>& indices, std::vector<double>& costs);
+
+  /**
+   * Costmap cost under the center of the end pose, which both the max and the
+   * sum of the pose costs reach, and which every stencil covering the end pose
+   * includes
+   */
+  double costLowerBound(Trajectory &traj);
+
+  void setSumScores(bool score_sums);
+  void setParams(double max_trans_vel, double max_scaling_factor, double scaling_speed);
+  void setFootprint(std::vector<geometry_msgs::Point> footprint_spec);
+
+  /**
+   * Score trajectories through cached swept footprint stencils, clears the cache
+   */
+  void setStencilCache(bool stencil_cache);
+
+  /**
+   * Accept and reject poses by their clearance before checking the footprint
+   */
+  void setDistanceField(bool distance_field) { distance_field_ = distance_field; }
+
+  /**
+   * Skip poses that cannot change the cost, judged from a max pooled costmap pyramid
+   */
+  void setPyramid(bool pyramid) { use_pyramid_ = pyramid; }
+
+  /**
+   * Whether the footprint at a pose in the given map cell can neither fail nor cost more than cost,
+   * judged from the pyramid
+   * @return True if so, false if it can or the pyramid cannot tell
+   */
+  bool poseAtMost(unsigned int cell_x, unsigned int cell_y, double cost) const;
+
+  /**
+   * Score against a snapshot of the costmap, NULL to read the costmap itself
+   */
+  void setSnapshot(CostmapSnapshot* snapshot) { snapshot_ = snapshot; }
+
+  bool getSumScores() const { return sum_scores_; }
+  bool hasFootprint() const { return ! footprint_spec_.empty(); }
+
+  /**
+   * Cost of the footprint at a single pose, as ObstacleCostFunction::footprintCost()
+   */
+  double poseCost(double x, double y, double th);
+
+  /**
+   * Same as poseCost(x, y, th) for a pose whose map cell is already known to be on the map
+   */
+  double poseCost(double x, double y, double th, unsigned int cell_x, unsigned int cell_y);
+
+  /**
+   * Cost of the trajectory from its swept footprint stencil, at least the exact cost
+   * @param cost Set to the cost
+   * @return False if there is no stencil for this trajectory or the footprint may fail at
+   * some pose, leaving cost alone
+   */
+  bool sweptCost(Trajectory &traj, double& cost);
+
+  /**
+   * Number of stencils found in and missing from the cache since the start
+   */
+  void getStencilStats(unsigned int& hits, unsigned int& misses);
+
+private:
+
+  /**
+   * A cell swept by the footprint, relative to the start cell, and whether a
+   * footprint outline may cross it
+   */
+  struct StencilCell {
+    int dx, dy;
+    bool outline;
+  };
+
+  struct StencilKey {
+    float xv, yv, thetav;
+    unsigned int num_points;
+    int heading;
+    bool operator<(const StencilKey& other) const;
+  };
+
+  typedef std::vector<StencilCell> Stencil;
+
+  double trajectoryCost(Trajectory &traj);
+
+  // map access while scoring, from the snapshot if there is one
+  bool toMap(double wx, double wy, unsigned int& mx, unsigned int& my) const {
+    return snapshot_ != NULL ? snapshot_->worldToMap(wx, wy, mx, my) : costmap_->worldToMap(wx, wy, mx, my);
+  }
+  unsigned char cellCost(unsigned int mx, unsigned int my) const {
+    return snapshot_ != NULL ? snapshot_->getCost(mx, my) : costmap_->getCost(mx, my);
+  }
+  WorldModel* worldModel() const {
+    return snapshot_ != NULL ? static_cast<WorldModel*>(snapshot_) : world_model_;
+  }
+
+  /**
+   * Rasterize the footprint along the trajectory, moved to start at the given
+   * heading from the center of the start cell, and dilate it by the error of
+   * start poses anywhere in that cell and within half a heading bin
+   */
+  boost::shared_ptr<const Stencil> buildStencil(Trajectory &traj, double heading);
+
+  costmap_2d::Costmap2D* costmap_;
+  CostmapModel* world_model_;
+  CostmapSnapshot* snapshot_;
+  std::vector<geometry_msgs::Point> footprint_spec_;
+  double inscribed_radius_, circumscribed_radius_;
+  double max_trans_vel_;
+  double max_scaling_factor_, scaling_speed_;
+  bool sum_scores_;
+
+  bool stencil_cache_;
+  double stencil_resolution_;
+  std::map<StencilKey, boost::shared_ptr<const Stencil> > stencils_;
+  unsigned int stencil_hits_, stencil_misses_;
+  boost::mutex stencil_mutex_;
+
+  bool distance_field_, fields_valid_;
+  // clearance from cells with any cost, and from lethal and unknown cells
+  DistanceField free_field_, lethal_field_;
+  double accept_distance_, reject_distance_;
+
+  bool use_pyramid_, pyramid_valid_;
+  CostmapPyramid pyramid_;
+  // cells around a pose that its footprint check may look at, and the map size the pyramid was built for
+  int pyramid_radius_;
+  unsigned int pyramid_size_x_, pyramid_size_y_;
+};
+
+} /* namespace base_local_planner */
+#endif /* BATCH_OBSTACLE_COST_FUNCTION_H */
@@ -0,0 +1,92 @@
+/*********************************************************************
+ *
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2017, Open Source Robotics Foundation, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Author: Jeeseon Kim
+ *********************************************************************/
+
+#ifndef COMPACT_MAP_GRID_H
+#define COMPACT_MAP_GRID_H
+
+#include <vector>
+
+namespace base_local_planner {
+
+/**
+ * The target distances of a MapGrid without the rest of its cells: one
+ * integer per cell instead of a MapCell with its coordinates and flags, 4
+ * instead of 24 bytes, so that the grid of a local costmap stays in cache
+ * while trajectories are looked up in it. Obstacle and unreachable cells
+ * hold the same values as in MapGrid, so lookups return the same costs.
+ */
+class CompactMapGrid {
+public:
+
+  CompactMapGrid() : size_x_(0), size_y_(0) {}
+
+  /**
+   * Resize the grid to the map, all cells unreachable if the size changed
+   * @return True if the size changed
+   */
+  bool sizeCheck(unsigned int size_x, unsigned int size_y);
+
+  /**
+   * Make all cells unreachable
+   */
+  void reset();
+
+  unsigned int& operator[](unsigned int index) { return value_[index]; }
+  unsigned int& operator()(unsigned int x, unsigned int y) { return value_[y * size_x_ + x]; }
+
+  /**
+   * Same as MapGrid(cx, cy).target_dist
+   */
+  double getCellCosts(unsigned int cx, unsigned int cy) const { return value_[cy * size_x_ + cx]; }
+
+  // the values of MapGrid::obstacleCosts() and MapGrid::unreachableCellCosts()
+  unsigned int obstacleValue() const { return size_x_ * size_y_; }
+  unsigned int unreachableValue() const { return size_x_ * size_y_ + 1; }
+  double obstacleCosts() const { return obstacleValue(); }
+  double unreachableCellCosts() const { return unreachableValue(); }
+
+  unsigned int getSizeX() const { return size_x_; }
+  unsigned int getSizeY() const { return size_y_; }
+
+private:
+
+  unsigned int size_x_, size_y_;
+  std::vector<unsigned int> value_;
+};
+
+} /* namespace base_local_planner */
+#endif /* COMPACT_MAP_GRID_H */
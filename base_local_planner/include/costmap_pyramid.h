@@ -0,0 +1,87 @@
+/*********************************************************************
+ *
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2017, Open Source Robotics Foundation, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Author: Jeeseon Kim
+ *********************************************************************/
+
+#ifndef COSTMAP_PYRAMID_H
+#define COSTMAP_PYRAMID_H
+
+#include <vector>
+#include <costmap_2d/costmap_2d.h>
+
+// number of coarse levels, each halving the resolution of the one below
+#define PYRAMID_LEVELS 3
+
+namespace base_local_planner {
+
+/**
+ * Max pooled copies of a costmap at 2x, 4x and 8x its cell size. A coarse
+ * cell holds the highest cost of the costmap cells it covers, so a region
+ * whose coarse cells are all low has no higher cost in any of its cells.
+ * Regions are tested from the coarsest level down, each level covering the
+ * region more tightly with more cells.
+ */
+class CostmapPyramid {
+public:
+
+  CostmapPyramid() {}
+
+  /**
+   * Pool the costs of the costmap as it is now
+   */
+  void build(const costmap_2d::Costmap2D& costmap);
+
+  /**
+   * Whether no cell in [x0, x1] x [y0, y1] costs more than cost, judging
+   * from the coarse levels only
+   * @return True if that holds, false if it does not or is only decided at full resolution
+   */
+  bool atMost(unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1, unsigned char cost) const;
+
+private:
+
+  /**
+   * Whether no cell of a level covering [x0, x1] x [y0, y1], in costmap cells, costs more than cost
+   */
+  bool coveredAtMost(unsigned int level, unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1,
+      unsigned char cost) const;
+
+  // level 0 is 2x, the cell size of level l is 2^(l + 1) costmap cells
+  std::vector<unsigned char> levels_[PYRAMID_LEVELS];
+  unsigned int size_x_[PYRAMID_LEVELS], size_y_[PYRAMID_LEVELS];
+};
+
+} /* namespace base_local_planner */
+#endif /* COSTMAP_PYRAMID_H */
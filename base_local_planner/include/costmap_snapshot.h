@@ -0,0 +1,143 @@
+/*********************************************************************
+ *
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2017, Open Source Robotics Foundation, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Author: Jeeseon Kim
+ *********************************************************************/
+
+#ifndef COSTMAP_SNAPSHOT_H
+#define COSTMAP_SNAPSHOT_H
+
+#include <vector>
+#include <costmap_2d/costmap_2d.h>
+#include <costmap_2d/cost_values.h>
+#include <base_local_planner/world_model.h>
+
+// cells per side of a tile is 1 << SNAPSHOT_TILE_SHIFT, 8x8 costs fill a cache line
+#define SNAPSHOT_TILE_SHIFT 3
+
+namespace base_local_planner {
+
+/**
+ * A copy of the costs of a square window of a costmap, taken once per
+ * cycle so that all trajectories are scored against the same costs. The
+ * costs are stored in tiles of 8x8 cells, so the cells under a footprint
+ * share few cache lines.
+ *
+ * Scoring against a snapshot does not need the lock of the costmap, but
+ * move_base holds that (recursive) lock across computeVelocityCommands(),
+ * so under move_base the gain is consistency and locality, not less
+ * contention.
+ *
+ * Cells are addressed in the coordinates of the whole costmap, with the
+ * geometry the costmap had when the snapshot was taken. Cells on the map but
+ * outside the window have no information. As a WorldModel it checks
+ * footprints like CostmapModel.
+ */
+class CostmapSnapshot: public WorldModel {
+public:
+
+  CostmapSnapshot() : origin_x_(0.0), origin_y_(0.0), resolution_(0.0), map_size_x_(0), map_size_y_(0),
+      x0_(0), y0_(0), size_x_(0), size_y_(0), tiles_x_(0) {}
+  ~CostmapSnapshot() {}
+
+  /**
+   * Copy the cells within radius of a point, the caller holds the lock of the costmap
+   * @param x The x coordinate of the point in the costmap frame
+   * @param y The y coordinate of the point in the costmap frame
+   * @param radius Distance from the point of the cells to copy
+   */
+  void take(const costmap_2d::Costmap2D& costmap, double x, double y, double radius);
+
+  double getOriginX() const { return origin_x_; }
+  double getOriginY() const { return origin_y_; }
+  double getResolution() const { return resolution_; }
+  unsigned int getSizeInCellsX() const { return map_size_x_; }
+  unsigned int getSizeInCellsY() const { return map_size_y_; }
+
+  /**
+   * Same as Costmap2D::worldToMap()
+   */
+  bool worldToMap(double wx, double wy, unsigned int& mx, unsigned int& my) const {
+    if (wx < origin_x_ || wy < origin_y_) {
+      return false;
+    }
+    mx = (int)((wx - origin_x_) / resolution_);
+    my = (int)((wy - origin_y_) / resolution_);
+    return mx < map_size_x_ && my < map_size_y_;
+  }
+
+  /**
+   * Whether a map cell is inside the window
+   */
+  bool inWindow(unsigned int mx, unsigned int my) const {
+    return mx - x0_ < size_x_ && my - y0_ < size_y_;
+  }
+
+  /**
+   * Cost of a map cell, NO_INFORMATION outside the window
+   */
+  unsigned char getCost(unsigned int mx, unsigned int my) const {
+    // cells left of or below the window wrap around to large values
+    unsigned int x = mx - x0_;
+    unsigned int y = my - y0_;
+    if (x >= size_x_ || y >= size_y_) {
+      return costmap_2d::NO_INFORMATION;
+    }
+    unsigned int tile = (y >> SNAPSHOT_TILE_SHIFT) * tiles_x_ + (x >> SNAPSHOT_TILE_SHIFT);
+    unsigned int mask = (1 << SNAPSHOT_TILE_SHIFT) - 1;
+    return costs_[(tile << (2 * SNAPSHOT_TILE_SHIFT)) + ((y & mask) << SNAPSHOT_TILE_SHIFT) + (x & mask)];
+  }
+
+  using WorldModel::footprintCost;
+
+  /**
+   * Same as CostmapModel::footprintCost()
+   */
+  double footprintCost(const geometry_msgs::Point& position, const std::vector<geometry_msgs::Point>& footprint,
+      double inscribed_radius, double circumscribed_radius);
+
+private:
+
+  double lineCost(int x0, int x1, int y0, int y1) const;
+  double pointCost(int x, int y) const;
+
+  double origin_x_, origin_y_, resolution_;
+  unsigned int map_size_x_, map_size_y_;
+  // the window in map cells, and its width in tiles
+  unsigned int x0_, y0_, size_x_, size_y_, tiles_x_;
+  std::vector<unsigned char> costs_;
+};
+
+} /* namespace base_local_planner */
+#endif /* COSTMAP_SNAPSHOT_H */
@@ -0,0 +1,78 @@
+/*********************************************************************
+ *
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2017, Open Source Robotics Foundation, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Author: Jeeseon Kim
+ *********************************************************************/
+
+#ifndef DISTANCE_FIELD_H
+#define DISTANCE_FIELD_H
+
+#include <vector>
+#include <costmap_2d/costmap_2d.h>
+
+namespace base_local_planner {
+
+/**
+ * Euclidean distance of every costmap cell to the nearest obstacle cell,
+ * between cell centers and in cells, computed with the linear time transform
+ * of Felzenszwalb and Huttenlocher. Obstacle cells are those with at least a
+ * given cost; cells just outside the map can count as obstacles as well.
+ */
+class DistanceField {
+public:
+
+  DistanceField() : size_x_(0), size_y_(0), border_(0) {}
+
+  /**
+   * Recompute the field for the current costmap
+   * @param min_cost The lowest cost of an obstacle cell
+   * @param off_map_obstacles Whether the cells around the map are obstacles
+   */
+  void compute(const costmap_2d::Costmap2D& costmap, unsigned char min_cost, bool off_map_obstacles);
+
+  /**
+   * Distance of a map cell to the nearest obstacle cell, huge if there is none
+   */
+  float getDistance(unsigned int cell_x, unsigned int cell_y) const {
+    return distance_[(cell_y + border_) * (size_x_ + 2 * border_) + cell_x + border_];
+  }
+
+private:
+
+  unsigned int size_x_, size_y_, border_;
+  std::vector<float> distance_;
+};
+
+} /* namespace base_local_planner */
+#endif /* DISTANCE_FIELD_H */
@@ -0,0 +1,250 @@
+/*********************************************************************
+ *
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2017, Open Source Robotics Foundation, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Author: Jeeseon Kim
+ *********************************************************************/
+
+#ifndef MAP_GRID_ENGINE_H
+#define MAP_GRID_ENGINE_H
+
+#include <deque>
+#include <vector>
+#include <costmap_2d/costmap_2d.h>
+#include <geometry_msgs/PoseStamped.h>
+#include <base_local_planner/compact_map_grid.h>
+
+namespace base_local_planner {
+
+/**
+ * Map grids shared by several map grid cost functions. A layer is
+ * propagated at the first request for its targets after reset(), and later
+ * requests for the same targets, like those of the path and the alignment
+ * costs, get the same grid. Grids of earlier cycles are reused as storage.
+ *
+ * Layers are CompactMapGrids with the same values as MapGrid. They are
+ * propagated breadth first from a queue of cell indices per distance, over
+ * integer distances and a byte of passable and neighbor flags per cell
+ * instead of MapCells.
+ *
+ * In incremental mode each layer keeps the integer distances, target cells
+ * and passable cells it was computed from. A new request repairs the layer
+ * of the last cycle with the most similar target cells instead of
+ * propagating from scratch: the layer is moved along with the origin of a
+ * rolling costmap, distances that lost their support through removed
+ * targets, newly blocked cells or cells that left the map are cleared level
+ * by level, and the cleared region and everything new targets or newly free
+ * cells can improve is propagated again. Layers are rebuilt when too many
+ * cells changed or too many distances lost their support, as when the local
+ * goal moves. The grids are the same as those of MapGrid.
+ *
+ * With a region of interest, distances are only propagated in a square
+ * window around it and the rest of the grid reads as unreachable. Paths
+ * that leave the window are accounted for by seeding its edge with the
+ * distances of a coarse grid over the whole map, so values near the edge
+ * are estimates; they are exact where the shortest path stays inside. A
+ * region of interest takes precedence over incremental mode.
+ */
+class MapGridEngine {
+public:
+
+  MapGridEngine(costmap_2d::Costmap2D* costmap) : costmap_(costmap), incremental_(false),
+      roi_x_(0.0), roi_y_(0.0), roi_radius_(0.0), cycle_(0), passable_cycle_(0), coarse_cycle_(0),
+      coarse_size_x_(0), coarse_size_y_(0), num_propagations_(0), num_repairs_(0) {}
+  ~MapGridEngine() {}
+
+  /**
+   * Start a new cycle, to be called once the costmap has changed. Layers of
+   * the last cycle are no longer handed out, but may be repaired.
+   */
+  void reset() { ++cycle_; }
+
+  /**
+   * Repair the layers of the last cycle instead of propagating them again
+   */
+  void setIncremental(bool incremental);
+
+  /**
+   * Only propagate the layers handed out from now on around a point
+   * @param x The x coordinate of the point in the costmap frame
+   * @param y The y coordinate of the point in the costmap frame
+   * @param radius Distance from the point that lookups stay within, 0 for the whole map
+   */
+  void setRegionOfInterest(double x, double y, double radius);
+
+  /**
+   * The grid of distances to the target poses, or to the local goal on them
+   * @return The layer, valid until the next reset()
+   */
+  const CompactMapGrid* getLayer(const std::vector<geometry_msgs::PoseStamped>& target_poses, bool is_local_goal);
+
+  /**
+   * The number of layers propagated from scratch since the engine was created
+   */
+  unsigned int getNumPropagations() const { return num_propagations_; }
+
+  /**
+   * The number of layers repaired since the engine was created
+   */
+  unsigned int getNumRepairs() const { return num_repairs_; }
+
+private:
+
+  // a rectangle of cells of the map
+  struct Window {
+    unsigned int x0, y0, size_x, size_y;
+  };
+
+  struct Layer {
+    Layer() : cycle(0), repairable(false), windowed(false) {}
+
+    std::vector<geometry_msgs::PoseStamped> target_poses;
+    bool is_local_goal;
+    unsigned int cycle;
+    CompactMapGrid grid;
+
+    // state of the last propagation, for incremental mode
+    bool repairable;
+    double origin_x, origin_y, resolution;
+    unsigned int size_x, size_y;
+    std::vector<unsigned int> seeds;
+    std::vector<int> distance;
+    std::vector<unsigned char> passable;
+
+    // the cells written by the last propagation in a region of interest
+    bool windowed;
+    Window window;
+  };
+
+  static bool sameTargets(const std::vector<geometry_msgs::PoseStamped>& a,
+      const std::vector<geometry_msgs::PoseStamped>& b);
+
+  /**
+   * The cells MapGrid propagates from, sorted
+   */
+  void findSeeds(const std::vector<geometry_msgs::PoseStamped>& target_poses, bool is_local_goal,
+      std::vector<unsigned int>& seeds);
+
+  /**
+   * Shift from the layer to the current map in cells, false if the layer cannot be moved onto it
+   */
+  bool getShift(const Layer& layer, int& shift_x, int& shift_y) const;
+
+  /**
+   * Number of target cells of the layer, moved onto the current map, that differ from seeds
+   */
+  unsigned int seedDifference(const Layer& layer, const std::vector<unsigned int>& seeds) const;
+
+  /**
+   * Passable and neighbor flags of the cells of a window of the costmap
+   */
+  void computeCells(const Window& window, std::vector<unsigned char>& cells) const;
+
+  void updatePassable();
+
+  /**
+   * Passable and neighbor flags of the coarse grid, a coarse cell is passable if any of its cells is
+   */
+  void updateCoarseCells();
+
+  /**
+   * The window of the region of interest, false if it is the whole map
+   */
+  bool getWindow(Window& window) const;
+
+  /**
+   * Propagate the layer inside a window only
+   */
+  void propagateWindow(Layer& layer, const std::vector<unsigned int>& seeds, const Window& window);
+
+  /**
+   * Seed a cell on the edge of the window with its coarse distance
+   */
+  void seedFromCoarse(const Window& window, unsigned int x, unsigned int y);
+
+  /**
+   * Propagate the layer from scratch for the current map
+   */
+  void rebuild(Layer& layer, const std::vector<unsigned int>& seeds);
+
+  /**
+   * Repair a layer of an earlier cycle for the current map, false if a rebuild is due
+   */
+  bool repair(Layer& layer, const std::vector<unsigned int>& seeds);
+
+  /**
+   * Lower the distances of the cells in the buckets and of everything reachable from them
+   * @param distance The distances of a grid
+   * @param cells The passable and neighbor flags of the same grid
+   * @param size_x The width of the grid
+   */
+  void propagate(std::vector<int>& distance, const std::vector<unsigned char>& cells,
+      unsigned int size_x, unsigned int first_level);
+
+  void pushCell(unsigned int index, int level);
+
+  /**
+   * Write the grid value of a cell from the distances
+   */
+  void writeCell(Layer& layer, unsigned int index);
+
+  void writeAll(Layer& layer);
+
+  costmap_2d::Costmap2D* costmap_;
+  bool incremental_;
+  double roi_x_, roi_y_, roi_radius_;
+  // a deque keeps the grids handed out in place when layers are added
+  std::deque<Layer> layers_;
+  unsigned int cycle_;
+
+  // passable cells of the current cycle and their neighbors on the map, shared by all layers
+  std::vector<unsigned char> passable_;
+  unsigned int passable_cycle_;
+
+  // coarse grid of the whole map and the window, for propagating in a region of interest
+  std::vector<unsigned char> coarse_cells_;
+  unsigned int coarse_cycle_, coarse_size_x_, coarse_size_y_;
+  std::vector<int> coarse_distance_;
+  std::vector<unsigned char> window_cells_;
+  std::vector<int> window_distance_;
+
+  // cells by distance level, and the cells whose distance changed
+  std::vector<std::vector<unsigned int> > buckets_;
+  std::vector<unsigned int> dirty_;
+
+  unsigned int num_propagations_;
+  unsigned int num_repairs_;
+};
+
+} /* namespace base_local_planner */
+#endif /* MAP_GRID_ENGINE_H */
@@ -39,29 +39,72 @@
 #define PROBABILITY_COST_FUNCTION_H
 
 #include <base_local_planner/trajectory_cost_function.h>
+#include <base_local_planner/batch_cost_function.h>
+#include <base_local_planner/bounded_cost_function.h>
 #include <vector>
 
 using namespace std;
 
 namespace base_local_planner {
 
+/**
+ * Probabilities of colliding with dynamic obstacles around a pose, by
+ * bearing and range from it
+ */
+struct PolarProbability {
+  PolarProbability() : origin_x(0.0), origin_y(0.0), origin_yaw(0.0), range_resolution(0.0), range_bins(0) {}
+
+  double origin_x, origin_y, origin_yaw;
+  double range_resolution;
+  unsigned int range_bins;
+  // range_bins values for each bearing, bins of equal angle counterclockwise from origin_yaw
+  std::vector<double> probability;
+};
+
 /**
  * This class provides a cost based on collision probability with dynamic obstacles.
+ *
+ * The probabilities are a histogram of directions, bins of equal angle
+ * counterclockwise from the heading of the robot, and the direction of a
+ * trajectory is looked up in it whatever the number of bins.
+ *
+ * In polar mode every point of a trajectory is looked up instead, by its
+ * bearing and range in a PolarProbability, and the cost is the highest
+ * probability of collision along it, discounted by the time the point is
+ * reached. Unlike the direction probabilities, which are safeties, lower
+ * costs are better in polar mode.
  */
-class ProbabilityCostFunction: public base_local_planner::TrajectoryCostFunction {
+class ProbabilityCostFunction: public base_local_planner::TrajectoryCostFunction, public BatchCostFunction,
+    public BoundedCostFunction {
 public:
 
-  ProbabilityCostFunction() {}
+  ProbabilityCostFunction() : polar_(false), discount_(1.0), cos_yaw_(1.0), sin_yaw_(0.0) {}
   ~ProbabilityCostFunction() {}
 
-  void setDirectionProbability(std::vector<double> & arr);
+  void setDirectionProbability(const std::vector<double> & arr);
+  void setPolarProbability(const PolarProbability& polar);
+  /**
+   * Score the points of trajectories in the polar probabilities rather than their direction
+   * @param discount Factor the probability of a point is discounted by per second of the trajectory
+   */
+  void setPolar(bool polar, double discount) { polar_ = polar; discount_ = discount; }
   double scoreTrajectory(Trajectory &traj);
+  void scoreTrajectories(std::vector<Trajectory>& trajs,
+      const std::vector<unsigned int>& indices, std::vector<double>& costs);
+  // the cost is a lookup per direction or point, so the bound is exact
+  double costLowerBound(Trajectory &traj) {return scoreTrajectory(traj);};
   bool prepare() {return true;};
 
 private:
 
+  double polarCost(Trajectory &traj) const;
+
   std::vector<double> vec_;
-  double cost_;
+
+  bool polar_;
+  double discount_;
+  PolarProbability polar_probability_;
+  double cos_yaw_, sin_yaw_;
 };
 
 } /* namespace base_local_planner */
@@ -0,0 +1,289 @@
+/*
+ * adaptive_trajectory_generator.cpp
+ *
+ *      Author: Jeeseon Kim
+ */
+
+#include <base_local_planner/adaptive_trajectory_generator.h>
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+// rollouts kept before the cache starts over, a few MB
+#define MAX_CACHED_ROLLOUTS 20000
+
+namespace base_local_planner {
+
+void AdaptiveTrajectoryGenerator::setParameters(
+    double sim_time,
+    double sim_granularity,
+    double angular_sim_granularity,
+    bool use_dwa,
+    double sim_period) {
+  SimpleTrajectoryGenerator::setParameters(sim_time, sim_granularity, angular_sim_granularity, use_dwa, sim_period);
+  rollouts_.clear();
+}
+
+void AdaptiveTrajectoryGenerator::setRolloutCache(double resolution) {
+  if (resolution != cache_resolution_) {
+    rollouts_.clear();
+  }
+  cache_resolution_ = std::max(0.0, resolution);
+}
+
+void AdaptiveTrajectoryGenerator::initialise(
+    const Eigen::Vector3f& pos,
+    const Eigen::Vector3f& vel,
+    const Eigen::Vector3f& goal,
+    base_local_planner::LocalPlannerLimits* limits,
+    const Eigen::Vector3f& vsamples,
+    bool discretize_by_time) {
+  SimpleTrajectoryGenerator::initialise(pos, vel, goal, limits, vsamples, discretize_by_time);
+
+  // the first and last sample of every dimension are the bounds of the window
+  min_vel_ = Eigen::Vector3f::Zero();
+  max_vel_ = Eigen::Vector3f::Zero();
+  coarse_step_ = Eigen::Vector3f::Zero();
+  sampled_.clear();
+  for (unsigned int i = 0; i < sample_params_.size(); ++i) {
+    if (i == 0) {
+      min_vel_ = sample_params_[i];
+      max_vel_ = sample_params_[i];
+    }
+    min_vel_ = min_vel_.cwiseMin(sample_params_[i]);
+    max_vel_ = max_vel_.cwiseMax(sample_params_[i]);
+  }
+  if (spread_order_) {
+    sortBySpread();
+  }
+  snapSamples();
+  grid_ = sample_params_;
+  // step of the coarse grid, as VelocityIterator spaces the samples
+  for (unsigned int d = 0; d < 3; ++d) {
+    int num_samples = std::max(2, int(vsamples[d]));
+    coarse_step_[d] = (max_vel_[d] - min_vel_[d]) / float(num_samples - 1);
+  }
+}
+
+void AdaptiveTrajectoryGenerator::sortBySpread() {
+  // index of each sample along every dimension of the grid
+  std::vector<float> values[3];
+  for (unsigned int d = 0; d < 3; ++d) {
+    for (unsigned int i = 0; i < sample_params_.size(); ++i) {
+      values[d].push_back(sample_params_[i][d]);
+    }
+    std::sort(values[d].begin(), values[d].end());
+    values[d].erase(std::unique(values[d].begin(), values[d].end()), values[d].end());
+  }
+
+  // a sample is on level l if its indices are multiples of 2^(depth - l) in all dimensions
+  std::vector<std::pair<int, unsigned int> > levels;
+  for (unsigned int i = 0; i < sample_params_.size(); ++i) {
+    int level = 0;
+    for (unsigned int d = 0; d < 3; ++d) {
+      int index = std::lower_bound(values[d].begin(), values[d].end(), sample_params_[i][d]) - values[d].begin();
+      int depth = 0;
+      while ((2 << depth) < int(values[d].size())) {
+        ++depth;
+      }
+      int dim_level = depth;
+      while (dim_level > 0 && index % (1 << (depth - dim_level + 1)) == 0) {
+        --dim_level;
+      }
+      level = std::max(level, dim_level);
+    }
+    levels.push_back(std::make_pair(level, i));
+  }
+  std::sort(levels.begin(), levels.end());
+
+  std::vector<Eigen::Vector3f> sorted;
+  for (unsigned int i = 0; i < levels.size(); ++i) {
+    sorted.push_back(sample_params_[levels[i].second]);
+  }
+  sample_params_.swap(sorted);
+}
+
+void AdaptiveTrajectoryGenerator::refineAround(const std::vector<Eigen::Vector3f>& seeds, int fine_samples) {
+  next_sample_index_ = 0;
+  sample_params_.clear();
+  fine_samples = std::max(2, fine_samples);
+  // grids of nearby seeds overlap
+  std::set<Eigen::Vector3f, VelocityLess> queued;
+
+  for (unsigned int s = 0; s < seeds.size(); ++s) {
+    // values of the local grid in each dimension, clamped to the window
+    std::vector<float> values[3];
+    for (unsigned int d = 0; d < 3; ++d) {
+      if (coarse_step_[d] <= 0) {
+        values[d].push_back(seeds[s][d]);
+        continue;
+      }
+      float fine_step = 2 * coarse_step_[d] / float(fine_samples - 1);
+      for (int j = 0; j < fine_samples; ++j) {
+        float v = seeds[s][d] - coarse_step_[d] + j * fine_step;
+        values[d].push_back(std::min(max_vel_[d], std::max(min_vel_[d], v)));
+      }
+    }
+
+    Eigen::Vector3f vel_samp;
+    for (unsigned int i = 0; i < values[0].size(); ++i) {
+      vel_samp[0] = values[0][i];
+      for (unsigned int j = 0; j < values[1].size(); ++j) {
+        vel_samp[1] = values[1][j];
+        for (unsigned int k = 0; k < values[2].size(); ++k) {
+          vel_samp[2] = values[2][k];
+          if (cache_resolution_ > 0 && use_dwa_) {
+            snapToLattice(vel_samp);
+          }
+          if (sampled_.find(vel_samp) == sampled_.end() && queued.insert(vel_samp).second) {
+            sample_params_.push_back(vel_samp);
+          }
+        }
+      }
+    }
+  }
+}
+
+void AdaptiveTrajectoryGenerator::resumeGrid(double fraction) {
+  next_sample_index_ = 0;
+  sample_params_.clear();
+  for (unsigned int i = 0; i < grid_.size(); ++i) {
+    if (sampled_.find(grid_[i]) == sampled_.end()) {
+      sample_params_.push_back(grid_[i]);
+    }
+  }
+  if (fraction >= 1.0 || sample_params_.empty()) {
+    return;
+  }
+  unsigned int num_kept = std::max(1, int(ceil(sample_params_.size() * std::max(0.0, fraction))));
+  if (spread_order_) {
+    // any prefix covers the window evenly
+    sample_params_.resize(num_kept);
+    return;
+  }
+  std::vector<Eigen::Vector3f> kept;
+  for (unsigned int i = 0; i < num_kept; ++i) {
+    kept.push_back(sample_params_[(unsigned long)i * sample_params_.size() / num_kept]);
+  }
+  sample_params_.swap(kept);
+}
+
+bool AdaptiveTrajectoryGenerator::nextTrajectory(Trajectory &comp_traj) {
+  bool result = false;
+  if (hasMoreTrajectories()) {
+    sampled_.insert(sample_params_[next_sample_index_]);
+    if (generateTrajectory(pos_, vel_, sample_params_[next_sample_index_], comp_traj)) {
+      result = true;
+    }
+  }
+  next_sample_index_++;
+  return result;
+}
+
+bool AdaptiveTrajectoryGenerator::snapToLattice(Eigen::Vector3f& vel_samp) const {
+  Eigen::Vector3f snapped;
+  for (unsigned int d = 0; d < 3; ++d) {
+    int k = int(floor(vel_samp[d] / cache_resolution_ + 0.5));
+    snapped[d] = float(k * cache_resolution_);
+    if (snapped[d] > max_vel_[d]) {
+      snapped[d] = float(--k * cache_resolution_);
+    } else if (snapped[d] < min_vel_[d]) {
+      snapped[d] = float(++k * cache_resolution_);
+    }
+    if (snapped[d] > max_vel_[d] || snapped[d] < min_vel_[d]) {
+      // the window is narrower than the lattice spacing
+      return false;
+    }
+  }
+  vel_samp = snapped;
+  return true;
+}
+
+void AdaptiveTrajectoryGenerator::snapSamples() {
+  if (cache_resolution_ <= 0 || !use_dwa_) {
+    return;
+  }
+  std::set<Eigen::Vector3f, VelocityLess> snapped;
+  std::vector<Eigen::Vector3f> samples;
+  for (unsigned int i = 0; i < sample_params_.size(); ++i) {
+    Eigen::Vector3f vel_samp = sample_params_[i];
+    snapToLattice(vel_samp);
+    if (snapped.insert(vel_samp).second) {
+      samples.push_back(vel_samp);
+    }
+  }
+  sample_params_.swap(samples);
+}
+
+bool AdaptiveTrajectoryGenerator::generateTrajectory(
+    Eigen::Vector3f pos,
+    Eigen::Vector3f vel,
+    Eigen::Vector3f sample_target_vel,
+    base_local_planner::Trajectory& traj) {
+  if (cache_resolution_ <= 0 || !use_dwa_) {
+    return SimpleTrajectoryGenerator::generateTrajectory(pos, vel, sample_target_vel, traj);
+  }
+
+  RolloutKey key;
+  int k[3];
+  for (unsigned int d = 0; d < 3; ++d) {
+    k[d] = int(floor(sample_target_vel[d] / cache_resolution_ + 0.5));
+    if (float(k[d] * cache_resolution_) != sample_target_vel[d]) {
+      // not on the lattice
+      return SimpleTrajectoryGenerator::generateTrajectory(pos, vel, sample_target_vel, traj);
+    }
+  }
+  // turning right is turning left mirrored at the x axis, with vy mirrored as well
+  bool mirrored = k[2] < 0;
+  key.vx = k[0];
+  key.vy = mirrored ? -k[1] : k[1];
+  key.vth = mirrored ? -k[2] : k[2];
+  key.discretize_by_time = discretize_by_time_;
+
+  std::map<RolloutKey, Rollout>::iterator it = rollouts_.find(key);
+  if (it == rollouts_.end()) {
+    if (rollouts_.size() >= MAX_CACHED_ROLLOUTS) {
+      rollouts_.clear();
+    }
+    // without continued acceleration the rollout does not depend on the current velocity
+    Trajectory origin_traj;
+    Rollout rollout;
+    Eigen::Vector3f key_vel(key.vx * cache_resolution_, key.vy * cache_resolution_, key.vth * cache_resolution_);
+    rollout.valid = SimpleTrajectoryGenerator::generateTrajectory(Eigen::Vector3f::Zero(), vel, key_vel, origin_traj);
+    rollout.time_delta = origin_traj.time_delta_;
+    double px, py, pth;
+    for (unsigned int i = 0; i < origin_traj.getPointsSize(); ++i) {
+      origin_traj.getPoint(i, px, py, pth);
+      rollout.x.push_back(px);
+      rollout.y.push_back(py);
+      rollout.th.push_back(pth);
+    }
+    it = rollouts_.insert(std::make_pair(key, rollout)).first;
+  }
+  const Rollout& rollout = it->second;
+
+  traj.cost_ = -1.0;
+  traj.resetPoints();
+  if (!rollout.valid) {
+    return false;
+  }
+  traj.time_delta_ = rollout.time_delta;
+  traj.xv_ = sample_target_vel[0];
+  traj.yv_ = sample_target_vel[1];
+  traj.thetav_ = sample_target_vel[2];
+
+  double sign = mirrored ? -1.0 : 1.0;
+  double cos_th = cos(pos[2]);
+  double sin_th = sin(pos[2]);
+  for (unsigned int i = 0; i < rollout.x.size(); ++i) {
+    double x = rollout.x[i];
+    double y = sign * rollout.y[i];
+    traj.addPoint(pos[0] + x * cos_th - y * sin_th,
+        pos[1] + x * sin_th + y * cos_th,
+        pos[2] + sign * rollout.th[i]);
+  }
+  return true;
+}
+
+} /* namespace base_local_planner */
@@ -0,0 +1,184 @@
+/*
+ * batch_map_grid_cost_function.cpp
+ *
+ *      Author: Jeeseon Kim
+ */
+
+#include <base_local_planner/batch_map_grid_cost_function.h>
+
+#include <math.h>
+#include <ros/console.h>
+
+namespace base_local_planner {
+
+BatchMapGridCostFunction::BatchMapGridCostFunction(costmap_2d::Costmap2D* costmap,
+    double xshift,
+    double yshift,
+    bool is_local_goal_function,
+    CostAggregationType aggregationType) :
+    grid_costs_(costmap, xshift, yshift, is_local_goal_function, aggregationType),
+    costmap_(costmap),
+    engine_(NULL),
+    layer_(NULL),
+    is_local_goal_function_(is_local_goal_function),
+    aggregationType_(aggregationType),
+    xshift_(xshift),
+    yshift_(yshift),
+    stop_on_failure_(true) {
+  grid_costs_.setStopOnFailure(stop_on_failure_);
+  geometry_ = getGeometry();
+}
+
+void BatchMapGridCostFunction::setXShift(double xshift) {
+  xshift_ = xshift;
+  grid_costs_.setXShift(xshift);
+}
+
+void BatchMapGridCostFunction::setYShift(double yshift) {
+  yshift_ = yshift;
+  grid_costs_.setYShift(yshift);
+}
+
+void BatchMapGridCostFunction::setStopOnFailure(bool stop_on_failure) {
+  stop_on_failure_ = stop_on_failure;
+  grid_costs_.setStopOnFailure(stop_on_failure);
+}
+
+void BatchMapGridCostFunction::setEngine(MapGridEngine* engine) {
+  engine_ = engine;
+  layer_ = NULL;
+}
+
+void BatchMapGridCostFunction::setTargetPoses(std::vector<geometry_msgs::PoseStamped> target_poses) {
+  target_poses_ = target_poses;
+  grid_costs_.setTargetPoses(target_poses);
+}
+
+bool BatchMapGridCostFunction::prepare() {
+  bool prepared = true;
+  if (engine_ != NULL) {
+    layer_ = engine_->getLayer(target_poses_, is_local_goal_function_);
+  } else {
+    layer_ = NULL;
+    prepared = grid_costs_.prepare();
+  }
+  // the grid is for the costmap as it is now, which may move before scoring is done
+  geometry_ = getGeometry();
+  return prepared;
+}
+
+double BatchMapGridCostFunction::scoreTrajectory(Trajectory &traj) {
+  if (layer_ == NULL) {
+    return grid_costs_.scoreTrajectory(traj);
+  }
+  return trajectoryCost(traj, geometry_);
+}
+
+BatchMapGridCostFunction::GridGeometry BatchMapGridCostFunction::getGeometry() {
+  GridGeometry geometry;
+  geometry.origin_x = costmap_->getOriginX();
+  geometry.origin_y = costmap_->getOriginY();
+  geometry.resolution = costmap_->getResolution();
+  geometry.size_x = costmap_->getSizeInCellsX();
+  geometry.size_y = costmap_->getSizeInCellsY();
+  geometry.obstacle_costs = obstacleCosts();
+  geometry.unreachable_costs = unreachableCellCosts();
+  return geometry;
+}
+
+double BatchMapGridCostFunction::trajectoryCost(Trajectory &traj, const GridGeometry& geometry) {
+  double cost = 0.0;
+  if (aggregationType_ == Product) {
+    cost = 1.0;
+  }
+  double px, py, pth;
+  double grid_dist;
+
+  for (unsigned int i = 0; i < traj.getPointsSize(); ++i) {
+    traj.getPoint(i, px, py, pth);
+
+    // translate point forward if specified
+    if (xshift_ != 0.0) {
+      px = px + xshift_ * cos(pth);
+      py = py + xshift_ * sin(pth);
+    }
+    // translate point sideways if specified
+    if (yshift_ != 0.0) {
+      px = px + yshift_ * cos(pth + M_PI_2);
+      py = py + yshift_ * sin(pth + M_PI_2);
+    }
+
+    // same checks as Costmap2D::worldToMap()
+    unsigned int cell_x = 0, cell_y = 0;
+    bool on_map = px >= geometry.origin_x && py >= geometry.origin_y;
+    if (on_map) {
+      cell_x = (int)((px - geometry.origin_x) / geometry.resolution);
+      cell_y = (int)((py - geometry.origin_y) / geometry.resolution);
+      on_map = cell_x < geometry.size_x && cell_y < geometry.size_y;
+    }
+    if ( ! on_map) {
+      ROS_WARN("Off Map %f, %f", px, py);
+      return -4.0;
+    }
+    grid_dist = getCellCosts(cell_x, cell_y);
+    // if a point on this trajectory has no clear path to the goal... it may be invalid
+    if (stop_on_failure_) {
+      if (grid_dist == geometry.obstacle_costs) {
+        return -3.0;
+      } else if (grid_dist == geometry.unreachable_costs) {
+        return -2.0;
+      }
+    }
+
+    switch( aggregationType_ ) {
+    case Last:
+      cost = grid_dist;
+      break;
+    case Sum:
+      cost += grid_dist;
+      break;
+    case Product:
+      if (cost > 0) {
+        cost *= grid_dist;
+      }
+      break;
+    }
+  }
+  return cost;
+}
+
+void BatchMapGridCostFunction::scoreTrajectories(std::vector<Trajectory>& trajs,
+    const std::vector<unsigned int>& indices, std::vector<double>& costs) {
+  costs.resize(indices.size());
+  for (unsigned int k = 0; k < indices.size(); ++k) {
+    costs[k] = trajectoryCost(trajs[indices[k]], geometry_);
+  }
+}
+
+double BatchMapGridCostFunction::costLowerBound(Trajectory &traj) {
+  if (aggregationType_ == Product || traj.getPointsSize() == 0) {
+    return 0.0;
+  }
+  double px, py, pth;
+  traj.getEndpoint(px, py, pth);
+  if (xshift_ != 0.0) {
+    px = px + xshift_ * cos(pth);
+    py = py + xshift_ * sin(pth);
+  }
+  if (yshift_ != 0.0) {
+    px = px + yshift_ * cos(pth + M_PI_2);
+    py = py + yshift_ * sin(pth + M_PI_2);
+  }
+  if (px < geometry_.origin_x || py < geometry_.origin_y) {
+    return 0.0;
+  }
+  unsigned int cell_x = (int)((px - geometry_.origin_x) / geometry_.resolution);
+  unsigned int cell_y = (int)((py - geometry_.origin_y) / geometry_.resolution);
+  if (cell_x >= geometry_.size_x || cell_y >= geometry_.size_y) {
+    return 0.0;
+  }
+  // grid values are never negative, so the last one bounds their sum as well
+  return getCellCosts(cell_x, cell_y);
+}
+
+} /* namespace base_local_planner */
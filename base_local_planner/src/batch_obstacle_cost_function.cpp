@@ -0,0 +1,448 @@
+/*
+ * batch_obstacle_cost_function.cpp
+ *
+ *      Author: Jeeseon Kim
+ */
+
+#include <base_local_planner/batch_obstacle_cost_function.h>
+
+#include <algorithm>
+#include <cmath>
+#include <costmap_2d/cost_values.h>
+#include <costmap_2d/footprint.h>
+#include <base_local_planner/line_iterator.h>
+#include <ros/console.h>
+
+// quantization of the start heading of cached stencils, coarse enough for the heading to stay
+// in its bin over several cycles, the start position is only known to its cell
+#define STENCIL_HEADING_BINS 64
+// stencils kept before the cache starts over
+#define MAX_CACHED_STENCILS 5000
+// cells between the pose and the farthest cell of its footprint outline, beyond the circumscribed radius
+#define OUTLINE_CELL_MARGIN 2.0
+// cells between the pose and the center of its map cell
+#define CENTER_CELL_MARGIN 0.71
+
+namespace base_local_planner {
+
+namespace {
+/**
+ * Grow the set cells of a width x height mask by radius cells in every direction, separably
+ */
+void dilate(std::vector<unsigned char>& mask, int width, int height, int radius) {
+  std::vector<unsigned char> rows(mask.size(), 0);
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      if (mask[y * width + x]) {
+        for (int k = std::max(0, x - radius); k <= std::min(width - 1, x + radius); ++k) {
+          rows[y * width + k] = 1;
+        }
+      }
+    }
+  }
+  std::fill(mask.begin(), mask.end(), 0);
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      if (rows[y * width + x]) {
+        for (int k = std::max(0, y - radius); k <= std::min(height - 1, y + radius); ++k) {
+          mask[k * width + x] = 1;
+        }
+      }
+    }
+  }
+}
+}
+
+bool BatchObstacleCostFunction::StencilKey::operator<(const StencilKey& other) const {
+  if (xv != other.xv) return xv < other.xv;
+  if (yv != other.yv) return yv < other.yv;
+  if (thetav != other.thetav) return thetav < other.thetav;
+  if (num_points != other.num_points) return num_points < other.num_points;
+  return heading < other.heading;
+}
+
+BatchObstacleCostFunction::BatchObstacleCostFunction(costmap_2d::Costmap2D* costmap) :
+    ObstacleCostFunction(costmap),
+    costmap_(costmap),
+    world_model_(NULL),
+    snapshot_(NULL),
+    inscribed_radius_(0.0),
+    circumscribed_radius_(0.0),
+    max_trans_vel_(0.0),
+    max_scaling_factor_(0.0),
+    scaling_speed_(0.0),
+    sum_scores_(false),
+    stencil_cache_(false),
+    stencil_resolution_(0.0),
+    stencil_hits_(0),
+    stencil_misses_(0),
+    distance_field_(false),
+    fields_valid_(false),
+    accept_distance_(0.0),
+    reject_distance_(0.0),
+    use_pyramid_(false),
+    pyramid_valid_(false),
+    pyramid_radius_(0),
+    pyramid_size_x_(0),
+    pyramid_size_y_(0) {
+  if (costmap != NULL) {
+    world_model_ = new CostmapModel(*costmap_);
+  }
+}
+
+BatchObstacleCostFunction::~BatchObstacleCostFunction() {
+  if (world_model_ != NULL) {
+    delete world_model_;
+  }
+}
+
+void BatchObstacleCostFunction::setSumScores(bool score_sums) {
+  sum_scores_ = score_sums;
+  ObstacleCostFunction::setSumScores(score_sums);
+}
+
+void BatchObstacleCostFunction::setParams(double max_trans_vel, double max_scaling_factor, double scaling_speed) {
+  if (max_scaling_factor != max_scaling_factor_ || scaling_speed != scaling_speed_) {
+    boost::mutex::scoped_lock l(stencil_mutex_);
+    stencils_.clear();
+  }
+  max_trans_vel_ = max_trans_vel;
+  max_scaling_factor_ = max_scaling_factor;
+  scaling_speed_ = scaling_speed;
+  ObstacleCostFunction::setParams(max_trans_vel, max_scaling_factor, scaling_speed);
+}
+
+void BatchObstacleCostFunction::setFootprint(std::vector<geometry_msgs::Point> footprint_spec) {
+  // the footprint is set every cycle, stencils only go when it changes
+  bool changed = footprint_spec.size() != footprint_spec_.size();
+  for (unsigned int i = 0; i < footprint_spec.size() && !changed; ++i) {
+    changed = footprint_spec[i].x != footprint_spec_[i].x || footprint_spec[i].y != footprint_spec_[i].y;
+  }
+  if (changed) {
+    boost::mutex::scoped_lock l(stencil_mutex_);
+    stencils_.clear();
+  }
+  footprint_spec_ = footprint_spec;
+  costmap_2d::calculateMinAndMaxDistances(footprint_spec_, inscribed_radius_, circumscribed_radius_);
+  ObstacleCostFunction::setFootprint(footprint_spec);
+}
+
+bool BatchObstacleCostFunction::prepare() {
+  fields_valid_ = false;
+  pyramid_valid_ = false;
+  if (footprint_spec_.size() < 3) {
+    return ObstacleCostFunction::prepare();
+  }
+  double resolution = costmap_->getResolution();
+  if (distance_field_) {
+    free_field_.compute(*costmap_, 1, true);
+    lethal_field_.compute(*costmap_, costmap_2d::LETHAL_OBSTACLE, false);
+    // distances are between cell centers, the outline cells reach beyond the footprint and the pose is off its cell center
+    accept_distance_ = circumscribed_radius_ / resolution + OUTLINE_CELL_MARGIN;
+    reject_distance_ = inscribed_radius_ / resolution - CENTER_CELL_MARGIN;
+    fields_valid_ = true;
+  }
+  if (use_pyramid_) {
+    pyramid_.build(*costmap_);
+    pyramid_radius_ = int(ceil(circumscribed_radius_ / resolution + OUTLINE_CELL_MARGIN));
+    pyramid_size_x_ = costmap_->getSizeInCellsX();
+    pyramid_size_y_ = costmap_->getSizeInCellsY();
+    pyramid_valid_ = true;
+  }
+  return ObstacleCostFunction::prepare();
+}
+
+bool BatchObstacleCostFunction::poseAtMost(unsigned int cell_x, unsigned int cell_y, double cost) const {
+  if ( ! pyramid_valid_) {
+    return false;
+  }
+  if (fields_valid_) {
+    // cheaper than the pyramid, and decides the bound of summed costs alone
+    if (free_field_.getDistance(cell_x, cell_y) > accept_distance_) {
+      return true;
+    }
+    if (cost < 1.0) {
+      return false;
+    }
+  }
+  // the footprint check fails off the map
+  int r = pyramid_radius_;
+  if (int(cell_x) < r || int(cell_y) < r || cell_x + r >= pyramid_size_x_ || cell_y + r >= pyramid_size_y_) {
+    return false;
+  }
+  // the pyramid is of the costmap, which the snapshot only agrees with inside its window
+  if (snapshot_ != NULL && ( ! snapshot_->inWindow(cell_x - r, cell_y - r) || ! snapshot_->inWindow(cell_x + r, cell_y + r))) {
+    return false;
+  }
+  // costs are whole numbers, and the check fails on lethal or unknown cells of the outline
+  unsigned char bound = (unsigned char)std::min(floor(cost), double(costmap_2d::INSCRIBED_INFLATED_OBSTACLE));
+  return pyramid_.atMost(cell_x - r, cell_y - r, cell_x + r, cell_y + r, bound);
+}
+
+void BatchObstacleCostFunction::setStencilCache(bool stencil_cache) {
+  boost::mutex::scoped_lock l(stencil_mutex_);
+  stencil_cache_ = stencil_cache;
+  stencils_.clear();
+}
+
+double BatchObstacleCostFunction::poseCost(double x, double y, double th) {
+  unsigned int cell_x, cell_y;
+  if (fields_valid_ && toMap(x, y, cell_x, cell_y)) {
+    return poseCost(x, y, th, cell_x, cell_y);
+  }
+  //check if the footprint is legal
+  double footprint_cost = worldModel()->footprintCost(x, y, th, footprint_spec_, inscribed_radius_, circumscribed_radius_);
+
+  if (footprint_cost < 0) {
+    return -6.0;
+  }
+
+  //we won't allow trajectories that go off the map... shouldn't happen that often anyways
+  if ( ! toMap(x, y, cell_x, cell_y)) {
+    return -7.0;
+  }
+
+  return std::max(std::max(0.0, footprint_cost), double(cellCost(cell_x, cell_y)));
+}
+
+double BatchObstacleCostFunction::poseCost(double x, double y, double th, unsigned int cell_x, unsigned int cell_y) {
+  if (fields_valid_) {
+    if (free_field_.getDistance(cell_x, cell_y) > accept_distance_) {
+      // no cost anywhere under the footprint, which lies within the map
+      return 0.0;
+    }
+    if (lethal_field_.getDistance(cell_x, cell_y) < reject_distance_) {
+      return -6.0;
+    }
+  }
+  double footprint_cost = worldModel()->footprintCost(x, y, th, footprint_spec_, inscribed_radius_, circumscribed_radius_);
+
+  if (footprint_cost < 0) {
+    return -6.0;
+  }
+  return std::max(std::max(0.0, footprint_cost), double(cellCost(cell_x, cell_y)));
+}
+
+double BatchObstacleCostFunction::trajectoryCost(Trajectory &traj) {
+  double cost = 0;
+  double px, py, pth;
+  if (footprint_spec_.size() == 0) {
+    // Bug, should never happen
+    ROS_ERROR("Footprint spec is empty, maybe missing call to setFootprint?");
+    return -9;
+  }
+
+  if (sweptCost(traj, cost)) {
+    return cost;
+  }
+
+  for (unsigned int i = 0; i < traj.getPointsSize(); ++i) {
+    traj.getPoint(i, px, py, pth);
+    unsigned int cell_x, cell_y;
+    if (pyramid_valid_ && toMap(px, py, cell_x, cell_y) && poseAtMost(cell_x, cell_y, sum_scores_ ? 0.0 : cost)) {
+      // neither fails nor adds to the cost
+      continue;
+    }
+    double f_cost = poseCost(px, py, pth);
+
+    if (f_cost < 0) {
+      return f_cost;
+    }
+
+    if (sum_scores_) {
+      cost += f_cost;
+    } else {
+      cost = std::max(cost, f_cost);
+    }
+  }
+  return cost;
+}
+
+void BatchObstacleCostFunction::getStencilStats(unsigned int& hits, unsigned int& misses) {
+  boost::mutex::scoped_lock l(stencil_mutex_);
+  hits = stencil_hits_;
+  misses = stencil_misses_;
+}
+
+boost::shared_ptr<const BatchObstacleCostFunction::Stencil> BatchObstacleCostFunction::buildStencil(
+    Trajectory &traj, double heading) {
+  double resolution = costmap_->getResolution();
+  unsigned int num_vertices = footprint_spec_.size();
+  unsigned int num_points = traj.getPointsSize();
+
+  // cells of the center and the footprint vertices of each pose, from the center of the start cell
+  // at the quantized start heading
+  std::vector<int> cells_x(num_points * (num_vertices + 1)), cells_y(num_points * (num_vertices + 1));
+  double px0, py0, pth0;
+  traj.getPoint(0, px0, py0, pth0);
+  double cos0 = cos(pth0), sin0 = sin(pth0);
+  double cos_h = cos(heading), sin_h = sin(heading);
+  double px, py, pth;
+  // farthest a vertex gets from the start position
+  double reach = 0.0;
+  for (unsigned int i = 0; i < num_points; ++i) {
+    traj.getPoint(i, px, py, pth);
+    double rx = (px - px0) * cos0 + (py - py0) * sin0;
+    double ry = (py - py0) * cos0 - (px - px0) * sin0;
+    double x = 0.5 * resolution + rx * cos_h - ry * sin_h;
+    double y = 0.5 * resolution + rx * sin_h + ry * cos_h;
+    double th = heading + pth - pth0;
+    double cos_th = cos(th), sin_th = sin(th);
+    unsigned int base = i * (num_vertices + 1);
+    for (unsigned int j = 0; j < num_vertices; ++j) {
+      double vx = x + footprint_spec_[j].x * cos_th - footprint_spec_[j].y * sin_th;
+      double vy = y + footprint_spec_[j].x * sin_th + footprint_spec_[j].y * cos_th;
+      cells_x[base + j] = int(floor(vx / resolution));
+      cells_y[base + j] = int(floor(vy / resolution));
+      reach = std::max(reach, hypot(vx - 0.5 * resolution, vy - 0.5 * resolution));
+    }
+    cells_x[base + num_vertices] = int(floor(x / resolution));
+    cells_y[base + num_vertices] = int(floor(y / resolution));
+  }
+
+  // start poses of the bin are off the cell center by at most half a cell along either axis,
+  // and turned by at most half a heading bin, which moves a point at most reach * angle
+  double error = 0.5 + M_PI / STENCIL_HEADING_BINS * reach / resolution;
+  // a point off by the error lands at most this many cells away, a line between such points one more
+  int center_margin = int(ceil(error));
+  int outline_margin = center_margin + 1;
+
+  // dense window around the swept area, lines stay within the vertices' box
+  int min_x = *std::min_element(cells_x.begin(), cells_x.end()) - outline_margin;
+  int min_y = *std::min_element(cells_y.begin(), cells_y.end()) - outline_margin;
+  int width = *std::max_element(cells_x.begin(), cells_x.end()) + outline_margin - min_x + 1;
+  int height = *std::max_element(cells_y.begin(), cells_y.end()) + outline_margin - min_y + 1;
+  std::vector<unsigned char> outline(width * height, 0), center(width * height, 0);
+  for (unsigned int i = 0; i < num_points; ++i) {
+    unsigned int base = i * (num_vertices + 1);
+    for (unsigned int j = 0; j < num_vertices; ++j) {
+      unsigned int k = (j + 1) % num_vertices;
+      for (LineIterator line(cells_x[base + j], cells_y[base + j], cells_x[base + k], cells_y[base + k]);
+          line.isValid(); line.advance()) {
+        outline[(line.getY() - min_y) * width + line.getX() - min_x] = 1;
+      }
+    }
+    center[(cells_y[base + num_vertices] - min_y) * width + cells_x[base + num_vertices] - min_x] = 1;
+  }
+  dilate(outline, width, height, outline_margin);
+  dilate(center, width, height, center_margin);
+
+  boost::shared_ptr<Stencil> stencil(new Stencil);
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      unsigned int index = y * width + x;
+      if (outline[index] || center[index]) {
+        StencilCell cell;
+        cell.dx = x + min_x;
+        cell.dy = y + min_y;
+        cell.outline = outline[index];
+        stencil->push_back(cell);
+      }
+    }
+  }
+  return stencil;
+}
+
+bool BatchObstacleCostFunction::sweptCost(Trajectory &traj, double& cost) {
+  // circular footprints and sums of pose costs are scored pose by pose
+  if ( ! stencil_cache_ || sum_scores_ || footprint_spec_.size() < 3 || traj.getPointsSize() == 0) {
+    return false;
+  }
+  double px, py, pth;
+  traj.getPoint(0, px, py, pth);
+  unsigned int cell_x, cell_y;
+  if ( ! toMap(px, py, cell_x, cell_y)) {
+    return false;
+  }
+
+  double resolution;
+  int size_x, size_y;
+  if (snapshot_ != NULL) {
+    resolution = snapshot_->getResolution();
+    size_x = snapshot_->getSizeInCellsX();
+    size_y = snapshot_->getSizeInCellsY();
+  } else {
+    resolution = costmap_->getResolution();
+    size_x = costmap_->getSizeInCellsX();
+    size_y = costmap_->getSizeInCellsY();
+  }
+  double heading = pth / (2 * M_PI);
+  heading -= floor(heading);
+
+  StencilKey key;
+  key.xv = traj.xv_;
+  key.yv = traj.yv_;
+  key.thetav = traj.thetav_;
+  key.num_points = traj.getPointsSize();
+  key.heading = std::min(int(heading * STENCIL_HEADING_BINS), STENCIL_HEADING_BINS - 1);
+
+  boost::shared_ptr<const Stencil> stencil;
+  {
+    boost::mutex::scoped_lock l(stencil_mutex_);
+    if (resolution != stencil_resolution_) {
+      stencils_.clear();
+      stencil_resolution_ = resolution;
+    }
+    std::map<StencilKey, boost::shared_ptr<const Stencil> >::iterator it = stencils_.find(key);
+    if (it != stencils_.end()) {
+      stencil = it->second;
+      stencil_hits_++;
+    } else {
+      stencil_misses_++;
+    }
+  }
+  if ( ! stencil) {
+    // rasterized at the center of the heading bin
+    stencil = buildStencil(traj, (key.heading + 0.5) * 2 * M_PI / STENCIL_HEADING_BINS);
+    boost::mutex::scoped_lock l(stencil_mutex_);
+    if (stencils_.size() >= MAX_CACHED_STENCILS) {
+      stencils_.clear();
+    }
+    stencils_[key] = stencil;
+  }
+
+  double max_cost = 0.0;
+  for (Stencil::const_iterator cell = stencil->begin(); cell != stencil->end(); ++cell) {
+    int x = int(cell_x) + cell->dx;
+    int y = int(cell_y) + cell->dy;
+    if (x < 0 || y < 0 || x >= size_x || y >= size_y) {
+      // a pose may reach off the map, which fails
+      return false;
+    }
+    unsigned char c = cellCost(x, y);
+    if (cell->outline && (c == costmap_2d::LETHAL_OBSTACLE || c == costmap_2d::NO_INFORMATION)) {
+      // the dilated outline may touch cells the exact one misses, so only the pose by pose check can tell
+      return false;
+    }
+    max_cost = std::max(max_cost, double(c));
+  }
+  cost = max_cost;
+  return true;
+}
+
+double BatchObstacleCostFunction::scoreTrajectory(Trajectory &traj) {
+  return trajectoryCost(traj);
+}
+
+void BatchObstacleCostFunction::scoreTrajectories(std::vector<Trajectory>& trajs,
+    const std::vector<unsigned int>& indices, std::vector<double>& costs) {
+  costs.resize(indices.size());
+  for (unsigned int k = 0; k < indices.size(); ++k) {
+    costs[k] = trajectoryCost(trajs[indices[k]]);
+  }
+}
+
+double BatchObstacleCostFunction::costLowerBound(Trajectory &traj) {
+  if (traj.getPointsSize() == 0) {
+    return 0.0;
+  }
+  double px, py, pth;
+  traj.getEndpoint(px, py, pth);
+  unsigned int cell_x, cell_y;
+  if ( ! toMap(px, py, cell_x, cell_y)) {
+    return 0.0;
+  }
+  return cellCost(cell_x, cell_y);
+}
+
+} /* namespace base_local_planner */
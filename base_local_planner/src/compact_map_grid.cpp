@@ -0,0 +1,26 @@
+/*
+ * compact_map_grid.cpp
+ *
+ *      Author: Jeeseon Kim
+ */
+
+#include <base_local_planner/compact_map_grid.h>
+
+namespace base_local_planner {
+
+bool CompactMapGrid::sizeCheck(unsigned int size_x, unsigned int size_y) {
+  if (size_x == size_x_ && size_y == size_y_ && value_.size() == size_x * size_y) {
+    return false;
+  }
+  size_x_ = size_x;
+  size_y_ = size_y;
+  value_.resize(size_x * size_y);
+  reset();
+  return true;
+}
+
+void CompactMapGrid::reset() {
+  value_.assign(value_.size(), unreachableValue());
+}
+
+} /* namespace base_local_planner */
@@ -0,0 +1,65 @@
+/*
+ * costmap_pyramid.cpp
+ *
+ *      Author: Jeeseon Kim
+ */
+
+#include <base_local_planner/costmap_pyramid.h>
+
+#include <algorithm>
+
+namespace base_local_planner {
+
+void CostmapPyramid::build(const costmap_2d::Costmap2D& costmap) {
+  const unsigned char* below = costmap.getCharMap();
+  unsigned int below_x = costmap.getSizeInCellsX();
+  unsigned int below_y = costmap.getSizeInCellsY();
+  for (unsigned int level = 0; level < PYRAMID_LEVELS; ++level) {
+    // odd sizes pool a single row or column at the far edge
+    unsigned int size_x = (below_x + 1) / 2;
+    unsigned int size_y = (below_y + 1) / 2;
+    std::vector<unsigned char>& pooled = levels_[level];
+    pooled.assign(size_x * size_y, 0);
+    for (unsigned int y = 0; y < below_y; ++y) {
+      const unsigned char* row = below + y * below_x;
+      unsigned char* target = &pooled[(y / 2) * size_x];
+      for (unsigned int x = 0; x < below_x; ++x) {
+        target[x / 2] = std::max(target[x / 2], row[x]);
+      }
+    }
+    size_x_[level] = size_x;
+    size_y_[level] = size_y;
+    below = &pooled[0];
+    below_x = size_x;
+    below_y = size_y;
+  }
+}
+
+bool CostmapPyramid::coveredAtMost(unsigned int level, unsigned int x0, unsigned int y0,
+    unsigned int x1, unsigned int y1, unsigned char cost) const {
+  unsigned int shift = level + 1;
+  const std::vector<unsigned char>& pooled = levels_[level];
+  for (unsigned int y = y0 >> shift; y <= (y1 >> shift); ++y) {
+    const unsigned char* row = &pooled[y * size_x_[level]];
+    for (unsigned int x = x0 >> shift; x <= (x1 >> shift); ++x) {
+      if (row[x] > cost) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+bool CostmapPyramid::atMost(unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1, unsigned char cost) const {
+  if (levels_[0].empty()) {
+    return false;
+  }
+  for (unsigned int level = PYRAMID_LEVELS; level-- > 0;) {
+    if (coveredAtMost(level, x0, y0, x1, y1, cost)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+} /* namespace base_local_planner */
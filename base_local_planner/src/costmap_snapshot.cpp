@@ -0,0 +1,110 @@
+/*
+ * costmap_snapshot.cpp
+ *
+ *      Author: Jeeseon Kim
+ */
+
+#include <base_local_planner/costmap_snapshot.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <base_local_planner/line_iterator.h>
+
+// cells added to the radius of the window
+#define SNAPSHOT_MARGIN_CELLS 2
+
+namespace base_local_planner {
+
+void CostmapSnapshot::take(const costmap_2d::Costmap2D& costmap, double x, double y, double radius) {
+  origin_x_ = costmap.getOriginX();
+  origin_y_ = costmap.getOriginY();
+  resolution_ = costmap.getResolution();
+  map_size_x_ = costmap.getSizeInCellsX();
+  map_size_y_ = costmap.getSizeInCellsY();
+
+  int center_x = int(floor((x - origin_x_) / resolution_));
+  int center_y = int(floor((y - origin_y_) / resolution_));
+  int cells = int(ceil(radius / resolution_)) + SNAPSHOT_MARGIN_CELLS;
+  int x0 = std::max(0, center_x - cells);
+  int y0 = std::max(0, center_y - cells);
+  int x1 = std::min(int(map_size_x_), center_x + cells + 1);
+  int y1 = std::min(int(map_size_y_), center_y + cells + 1);
+  x0_ = x0;
+  y0_ = y0;
+  size_x_ = std::max(0, x1 - x0);
+  size_y_ = std::max(0, y1 - y0);
+
+  unsigned int tile_size = 1 << SNAPSHOT_TILE_SHIFT;
+  tiles_x_ = (size_x_ + tile_size - 1) >> SNAPSHOT_TILE_SHIFT;
+  unsigned int tiles_y = (size_y_ + tile_size - 1) >> SNAPSHOT_TILE_SHIFT;
+  costs_.assign((tiles_x_ * tiles_y) << (2 * SNAPSHOT_TILE_SHIFT), costmap_2d::NO_INFORMATION);
+
+  // each row of the window goes into one row of a line of tiles
+  const unsigned char* charmap = costmap.getCharMap();
+  for (unsigned int row = 0; row < size_y_; ++row) {
+    const unsigned char* source = charmap + (y0_ + row) * map_size_x_ + x0_;
+    unsigned char* target = &costs_[((row >> SNAPSHOT_TILE_SHIFT) * tiles_x_ << (2 * SNAPSHOT_TILE_SHIFT)) +
+        ((row & (tile_size - 1)) << SNAPSHOT_TILE_SHIFT)];
+    for (unsigned int column = 0; column < size_x_; column += tile_size) {
+      memcpy(target, source + column, std::min(tile_size, size_x_ - column));
+      target += tile_size * tile_size;
+    }
+  }
+}
+
+double CostmapSnapshot::footprintCost(const geometry_msgs::Point& position, const std::vector<geometry_msgs::Point>& footprint,
+    double /* inscribed_radius */, double /* circumscribed_radius */) {
+  unsigned int cell_x, cell_y;
+  if ( ! worldToMap(position.x, position.y, cell_x, cell_y)) {
+    return -1.0;
+  }
+  if (footprint.size() < 3) {
+    unsigned char cost = getCost(cell_x, cell_y);
+    if (cost == costmap_2d::NO_INFORMATION) {
+      return -2.0;
+    }
+    if (cost == costmap_2d::LETHAL_OBSTACLE || cost == costmap_2d::INSCRIBED_INFLATED_OBSTACLE) {
+      return -1.0;
+    }
+    return cost;
+  }
+
+  // the outline of the footprint, closing it from the last vertex to the first
+  unsigned int x0, x1, y0, y1;
+  double footprint_cost = 0.0;
+  for (unsigned int i = 0; i < footprint.size(); ++i) {
+    unsigned int j = (i + 1) % footprint.size();
+    if ( ! worldToMap(footprint[i].x, footprint[i].y, x0, y0) || ! worldToMap(footprint[j].x, footprint[j].y, x1, y1)) {
+      return -1.0;
+    }
+    double line_cost = lineCost(x0, x1, y0, y1);
+    if (line_cost < 0) {
+      return -1.0;
+    }
+    footprint_cost = std::max(line_cost, footprint_cost);
+  }
+  return footprint_cost;
+}
+
+double CostmapSnapshot::lineCost(int x0, int x1, int y0, int y1) const {
+  double line_cost = 0.0;
+  for (LineIterator line(x0, y0, x1, y1); line.isValid(); line.advance()) {
+    double point_cost = pointCost(line.getX(), line.getY());
+    if (point_cost < 0) {
+      return point_cost;
+    }
+    line_cost = std::max(line_cost, point_cost);
+  }
+  return line_cost;
+}
+
+double CostmapSnapshot::pointCost(int x, int y) const {
+  unsigned char cost = getCost(x, y);
+  if (cost == costmap_2d::NO_INFORMATION || cost == costmap_2d::LETHAL_OBSTACLE) {
+    return -1;
+  }
+  return cost;
+}
+
+} /* namespace base_local_planner */
@@ -0,0 +1,94 @@
+/*
+ * distance_field.cpp
+ *
+ *      Author: Jeeseon Kim
+ */
+
+#include <base_local_planner/distance_field.h>
+
+#include <algorithm>
+#include <cmath>
+
+// squared distance of cells without any obstacle, larger than any on the map
+#define FAR_DISTANCE_SQ 1e20f
+
+namespace base_local_planner {
+
+namespace {
+
+// position where the parabolas rooted at q and p intersect
+float intersection(const float* f, int q, int p) {
+  return ((f[q] + q * q) - (f[p] + p * p)) / (2.0f * (q - p));
+}
+
+/**
+ * Squared distance transform of the sampled function f along one line, the
+ * lower envelope of the parabolas rooted at each sample
+ */
+void transformLine(const float* f, float* d, unsigned int n, std::vector<int>& v, std::vector<float>& z) {
+  int k = 0;
+  v[0] = 0;
+  z[0] = -FAR_DISTANCE_SQ;
+  z[1] = FAR_DISTANCE_SQ;
+  for (int q = 1; q < int(n); ++q) {
+    float s = intersection(f, q, v[k]);
+    while (s <= z[k]) {
+      --k;
+      s = intersection(f, q, v[k]);
+    }
+    ++k;
+    v[k] = q;
+    z[k] = s;
+    z[k + 1] = FAR_DISTANCE_SQ;
+  }
+  k = 0;
+  for (int q = 0; q < int(n); ++q) {
+    while (z[k + 1] < q) {
+      ++k;
+    }
+    d[q] = (q - v[k]) * (q - v[k]) + f[v[k]];
+  }
+}
+
+}
+
+void DistanceField::compute(const costmap_2d::Costmap2D& costmap, unsigned char min_cost, bool off_map_obstacles) {
+  size_x_ = costmap.getSizeInCellsX();
+  size_y_ = costmap.getSizeInCellsY();
+  border_ = off_map_obstacles ? 1 : 0;
+  unsigned int width = size_x_ + 2 * border_;
+  unsigned int height = size_y_ + 2 * border_;
+  distance_.assign(width * height, FAR_DISTANCE_SQ);
+
+  const unsigned char* cost = costmap.getCharMap();
+  for (unsigned int y = 0; y < height; ++y) {
+    for (unsigned int x = 0; x < width; ++x) {
+      bool off_map = x < border_ || y < border_ || x >= size_x_ + border_ || y >= size_y_ + border_;
+      if (off_map || cost[(y - border_) * size_x_ + x - border_] >= min_cost) {
+        distance_[y * width + x] = 0.0f;
+      }
+    }
+  }
+
+  // columns, then rows of the column distances
+  unsigned int n = std::max(width, height);
+  std::vector<float> f(n), d(n), z(n + 1);
+  std::vector<int> v(n);
+  for (unsigned int x = 0; x < width; ++x) {
+    for (unsigned int y = 0; y < height; ++y) {
+      f[y] = distance_[y * width + x];
+    }
+    transformLine(&f[0], &d[0], height, v, z);
+    for (unsigned int y = 0; y < height; ++y) {
+      distance_[y * width + x] = d[y];
+    }
+  }
+  for (unsigned int y = 0; y < height; ++y) {
+    transformLine(&distance_[y * width], &d[0], width, v, z);
+    for (unsigned int x = 0; x < width; ++x) {
+      distance_[y * width + x] = sqrt(d[x]);
+    }
+  }
+}
+
+} /* namespace base_local_planner */
@@ -0,0 +1,633 @@
+/*
+ * map_grid_engine.cpp
+ *
+ *      Author: Jeeseon Kim
+ */
+
+#include <base_local_planner/map_grid_engine.h>
+#include <base_local_planner/map_grid.h>
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <iterator>
+#include <costmap_2d/cost_values.h>
+#include <ros/console.h>
+
+// share of the cells that may change before a layer is rebuilt instead of repaired
+#define REPAIR_MAX_CHANGED_FRACTION 0.1
+// cells per side of a cell of the coarse grid used around a region of interest
+#define ROI_COARSE_FACTOR 4
+// cells added to the radius of a region of interest
+#define ROI_MARGIN_CELLS 2
+
+namespace base_local_planner {
+
+namespace {
+const int UNREACHED = INT_MAX;
+// flags of a cell in the passable map, which also tell which neighbors are on the map
+const unsigned char PASSABLE = 1;
+const unsigned char HAS_LEFT = 2;
+const unsigned char HAS_RIGHT = 4;
+const unsigned char HAS_DOWN = 8;
+const unsigned char HAS_UP = 16;
+// flags of cells that were not on the map of a layer
+const unsigned char NEW_CELL = 0xff;
+
+unsigned char neighborFlags(unsigned int x, unsigned int y, unsigned int size_x, unsigned int size_y) {
+  unsigned char flags = 0;
+  if (x > 0) flags |= HAS_LEFT;
+  if (x < size_x - 1) flags |= HAS_RIGHT;
+  if (y > 0) flags |= HAS_DOWN;
+  if (y < size_y - 1) flags |= HAS_UP;
+  return flags;
+}
+
+bool isPassable(unsigned char cost) {
+  return cost != costmap_2d::LETHAL_OBSTACLE &&
+      cost != costmap_2d::INSCRIBED_INFLATED_OBSTACLE &&
+      cost != costmap_2d::NO_INFORMATION;
+}
+}
+
+bool MapGridEngine::sameTargets(const std::vector<geometry_msgs::PoseStamped>& a,
+    const std::vector<geometry_msgs::PoseStamped>& b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  // the grids only depend on the target positions
+  for (unsigned int i = 0; i < a.size(); ++i) {
+    if (a[i].pose.position.x != b[i].pose.position.x || a[i].pose.position.y != b[i].pose.position.y) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void MapGridEngine::setIncremental(bool incremental) {
+  if (incremental != incremental_) {
+    for (unsigned int i = 0; i < layers_.size(); ++i) {
+      layers_[i].repairable = false;
+    }
+  }
+  incremental_ = incremental;
+}
+
+void MapGridEngine::setRegionOfInterest(double x, double y, double radius) {
+  roi_x_ = x;
+  roi_y_ = y;
+  roi_radius_ = radius;
+}
+
+const CompactMapGrid* MapGridEngine::getLayer(const std::vector<geometry_msgs::PoseStamped>& target_poses, bool is_local_goal) {
+  for (unsigned int i = 0; i < layers_.size(); ++i) {
+    if (layers_[i].cycle == cycle_ && layers_[i].is_local_goal == is_local_goal && sameTargets(layers_[i].target_poses, target_poses)) {
+      return &layers_[i].grid;
+    }
+  }
+
+  Window window;
+  bool windowed = getWindow(window);
+  bool repairing = incremental_ && ! windowed;
+  std::vector<unsigned int> seeds;
+  findSeeds(target_poses, is_local_goal, seeds);
+
+  // a layer not handed out in this cycle, the one closest to the targets when repairing
+  Layer* layer = NULL;
+  unsigned int best_difference = UINT_MAX;
+  for (unsigned int i = 0; i < layers_.size(); ++i) {
+    if (layers_[i].cycle == cycle_) {
+      continue;
+    }
+    unsigned int difference = repairing ? seedDifference(layers_[i], seeds) : 0;
+    if (layer == NULL || difference < best_difference) {
+      layer = &layers_[i];
+      best_difference = difference;
+    }
+  }
+  if (layer == NULL) {
+    layers_.push_back(Layer());
+    layer = &layers_.back();
+  }
+  layer->target_poses = target_poses;
+  layer->is_local_goal = is_local_goal;
+  layer->cycle = cycle_;
+
+  if (windowed) {
+    layer->repairable = false;
+    propagateWindow(*layer, seeds, window);
+    ++num_propagations_;
+    return &layer->grid;
+  }
+
+  layer->windowed = false;
+  updatePassable();
+  if ( ! incremental_) {
+    layer->repairable = false;
+    rebuild(*layer, seeds);
+    ++num_propagations_;
+    return &layer->grid;
+  }
+
+  if (repair(*layer, seeds)) {
+    ++num_repairs_;
+  } else {
+    rebuild(*layer, seeds);
+    ++num_propagations_;
+  }
+
+  layer->repairable = true;
+  layer->origin_x = costmap_->getOriginX();
+  layer->origin_y = costmap_->getOriginY();
+  layer->resolution = costmap_->getResolution();
+  layer->size_x = costmap_->getSizeInCellsX();
+  layer->size_y = costmap_->getSizeInCellsY();
+  layer->seeds = seeds;
+  layer->passable = passable_;
+  return &layer->grid;
+}
+
+void MapGridEngine::findSeeds(const std::vector<geometry_msgs::PoseStamped>& target_poses, bool is_local_goal,
+    std::vector<unsigned int>& seeds) {
+  // same target cells as MapGrid::setTargetCells() and MapGrid::setLocalGoal()
+  std::vector<geometry_msgs::PoseStamped> adjusted_global_plan;
+  MapGrid::adjustPlanResolution(target_poses, adjusted_global_plan, costmap_->getResolution());
+  bool started_path = false;
+  unsigned int map_x, map_y;
+  for (unsigned int i = 0; i < adjusted_global_plan.size(); ++i) {
+    double g_x = adjusted_global_plan[i].pose.position.x;
+    double g_y = adjusted_global_plan[i].pose.position.y;
+    if (costmap_->worldToMap(g_x, g_y, map_x, map_y) && costmap_->getCost(map_x, map_y) != costmap_2d::NO_INFORMATION) {
+      if (is_local_goal) {
+        seeds.clear();
+      }
+      seeds.push_back(costmap_->getIndex(map_x, map_y));
+      started_path = true;
+    } else if (started_path) {
+      break;
+    }
+  }
+  if ( ! started_path) {
+    ROS_ERROR("None of the points of the global plan were in the local costmap and free");
+  }
+  std::sort(seeds.begin(), seeds.end());
+  seeds.erase(std::unique(seeds.begin(), seeds.end()), seeds.end());
+}
+
+bool MapGridEngine::getShift(const Layer& layer, int& shift_x, int& shift_y) const {
+  double resolution = costmap_->getResolution();
+  if ( ! layer.repairable || layer.resolution != resolution ||
+      layer.size_x != costmap_->getSizeInCellsX() || layer.size_y != costmap_->getSizeInCellsY()) {
+    return false;
+  }
+  // a rolling costmap moves by whole cells
+  double dx = (costmap_->getOriginX() - layer.origin_x) / resolution;
+  double dy = (costmap_->getOriginY() - layer.origin_y) / resolution;
+  shift_x = int(floor(dx + 0.5));
+  shift_y = int(floor(dy + 0.5));
+  return fabs(dx - shift_x) < 1e-3 && fabs(dy - shift_y) < 1e-3 &&
+      std::abs(shift_x) < int(layer.size_x) && std::abs(shift_y) < int(layer.size_y);
+}
+
+unsigned int MapGridEngine::seedDifference(const Layer& layer, const std::vector<unsigned int>& seeds) const {
+  int shift_x, shift_y;
+  if ( ! getShift(layer, shift_x, shift_y)) {
+    return UINT_MAX;
+  }
+  std::vector<unsigned int> moved;
+  for (unsigned int i = 0; i < layer.seeds.size(); ++i) {
+    int x = int(layer.seeds[i] % layer.size_x) - shift_x;
+    int y = int(layer.seeds[i] / layer.size_x) - shift_y;
+    if (x >= 0 && y >= 0 && x < int(layer.size_x) && y < int(layer.size_y)) {
+      moved.push_back(y * layer.size_x + x);
+    }
+  }
+  std::sort(moved.begin(), moved.end());
+  std::vector<unsigned int> difference;
+  std::set_symmetric_difference(moved.begin(), moved.end(), seeds.begin(), seeds.end(), std::back_inserter(difference));
+  return difference.size();
+}
+
+void MapGridEngine::computeCells(const Window& window, std::vector<unsigned char>& cells) const {
+  // cells MapGrid propagates through, and the neighbors inside the window, which
+  // saves finding the coordinates of each cell while propagating
+  unsigned int map_size_x = costmap_->getSizeInCellsX();
+  const unsigned char* cost = costmap_->getCharMap();
+  cells.resize(window.size_x * window.size_y);
+  for (unsigned int y = 0; y < window.size_y; ++y) {
+    const unsigned char* row = cost + (window.y0 + y) * map_size_x + window.x0;
+    for (unsigned int x = 0; x < window.size_x; ++x) {
+      unsigned char flags = neighborFlags(x, y, window.size_x, window.size_y);
+      if (isPassable(row[x])) {
+        flags |= PASSABLE;
+      }
+      cells[y * window.size_x + x] = flags;
+    }
+  }
+}
+
+void MapGridEngine::updatePassable() {
+  unsigned int size = costmap_->getSizeInCellsX() * costmap_->getSizeInCellsY();
+  if (passable_cycle_ == cycle_ && passable_.size() == size) {
+    return;
+  }
+  Window map = {0, 0, costmap_->getSizeInCellsX(), costmap_->getSizeInCellsY()};
+  computeCells(map, passable_);
+  passable_cycle_ = cycle_;
+}
+
+void MapGridEngine::updateCoarseCells() {
+  unsigned int size_x = costmap_->getSizeInCellsX();
+  unsigned int size_y = costmap_->getSizeInCellsY();
+  unsigned int coarse_size_x = (size_x + ROI_COARSE_FACTOR - 1) / ROI_COARSE_FACTOR;
+  unsigned int coarse_size_y = (size_y + ROI_COARSE_FACTOR - 1) / ROI_COARSE_FACTOR;
+  if (coarse_cycle_ == cycle_ && coarse_size_x_ == coarse_size_x && coarse_size_y_ == coarse_size_y) {
+    return;
+  }
+  coarse_size_x_ = coarse_size_x;
+  coarse_size_y_ = coarse_size_y;
+  coarse_cells_.resize(coarse_size_x * coarse_size_y);
+  for (unsigned int y = 0; y < coarse_size_y; ++y) {
+    for (unsigned int x = 0; x < coarse_size_x; ++x) {
+      coarse_cells_[y * coarse_size_x + x] = neighborFlags(x, y, coarse_size_x, coarse_size_y);
+    }
+  }
+  // optimistic, so that the estimates do not close narrow passages
+  const unsigned char* cost = costmap_->getCharMap();
+  for (unsigned int y = 0; y < size_y; ++y) {
+    unsigned char* coarse_row = &coarse_cells_[(y / ROI_COARSE_FACTOR) * coarse_size_x];
+    for (unsigned int x = 0; x < size_x; ++x) {
+      if (isPassable(cost[y * size_x + x])) {
+        coarse_row[x / ROI_COARSE_FACTOR] |= PASSABLE;
+      }
+    }
+  }
+  coarse_cycle_ = cycle_;
+}
+
+bool MapGridEngine::getWindow(Window& window) const {
+  if (roi_radius_ <= 0.0) {
+    return false;
+  }
+  int size_x = costmap_->getSizeInCellsX();
+  int size_y = costmap_->getSizeInCellsY();
+  double resolution = costmap_->getResolution();
+  int center_x = int(floor((roi_x_ - costmap_->getOriginX()) / resolution));
+  int center_y = int(floor((roi_y_ - costmap_->getOriginY()) / resolution));
+  int radius = int(ceil(roi_radius_ / resolution)) + ROI_MARGIN_CELLS;
+  int x0 = std::max(0, center_x - radius);
+  int y0 = std::max(0, center_y - radius);
+  int x1 = std::min(size_x, center_x + radius + 1);
+  int y1 = std::min(size_y, center_y + radius + 1);
+  if (x0 >= x1 || y0 >= y1 || (x0 == 0 && y0 == 0 && x1 == size_x && y1 == size_y)) {
+    return false;
+  }
+  window.x0 = x0;
+  window.y0 = y0;
+  window.size_x = x1 - x0;
+  window.size_y = y1 - y0;
+  return true;
+}
+
+void MapGridEngine::seedFromCoarse(const Window& window, unsigned int x, unsigned int y) {
+  unsigned int index = y * window.size_x + x;
+  if ( ! (window_cells_[index] & PASSABLE)) {
+    return;
+  }
+  unsigned int coarse_index = ((window.y0 + y) / ROI_COARSE_FACTOR) * coarse_size_x_ +
+      (window.x0 + x) / ROI_COARSE_FACTOR;
+  if (coarse_distance_[coarse_index] == UNREACHED) {
+    return;
+  }
+  int level = coarse_distance_[coarse_index] * ROI_COARSE_FACTOR;
+  if (level < window_distance_[index]) {
+    window_distance_[index] = level;
+    pushCell(index, level);
+  }
+}
+
+void MapGridEngine::propagateWindow(Layer& layer, const std::vector<unsigned int>& seeds, const Window& window) {
+  unsigned int size_x = costmap_->getSizeInCellsX();
+  unsigned int size_y = costmap_->getSizeInCellsY();
+
+  // distances to the targets over the whole map, in coarse cells
+  updateCoarseCells();
+  coarse_distance_.assign(coarse_cells_.size(), UNREACHED);
+  for (unsigned int i = 0; i < seeds.size(); ++i) {
+    unsigned int coarse_index = (seeds[i] / size_x / ROI_COARSE_FACTOR) * coarse_size_x_ +
+        (seeds[i] % size_x) / ROI_COARSE_FACTOR;
+    if (coarse_distance_[coarse_index] != 0) {
+      coarse_distance_[coarse_index] = 0;
+      pushCell(coarse_index, 0);
+    }
+  }
+  propagate(coarse_distance_, coarse_cells_, coarse_size_x_, 0);
+
+  // exact distances inside the window from the targets in it, and estimates
+  // from the coarse grid where the window does not end at the map edge
+  computeCells(window, window_cells_);
+  window_distance_.assign(window_cells_.size(), UNREACHED);
+  for (unsigned int i = 0; i < seeds.size(); ++i) {
+    unsigned int x = seeds[i] % size_x;
+    unsigned int y = seeds[i] / size_x;
+    if (x >= window.x0 && y >= window.y0 && x < window.x0 + window.size_x && y < window.y0 + window.size_y) {
+      unsigned int index = (y - window.y0) * window.size_x + x - window.x0;
+      window_distance_[index] = 0;
+      pushCell(index, 0);
+    }
+  }
+  for (unsigned int x = 0; x < window.size_x; ++x) {
+    if (window.y0 > 0) seedFromCoarse(window, x, 0);
+    if (window.y0 + window.size_y < size_y) seedFromCoarse(window, x, window.size_y - 1);
+  }
+  for (unsigned int y = 0; y < window.size_y; ++y) {
+    if (window.x0 > 0) seedFromCoarse(window, 0, y);
+    if (window.x0 + window.size_x < size_x) seedFromCoarse(window, window.size_x - 1, y);
+  }
+  propagate(window_distance_, window_cells_, window.size_x, 0);
+  dirty_.clear();
+
+  // everything outside the window reads as unreachable, only the cells of the
+  // last window need to be reset when the grid already holds one
+  CompactMapGrid& grid = layer.grid;
+  unsigned int unreachable = grid.unreachableValue();
+  if (grid.sizeCheck(size_x, size_y)) {
+    // all unreachable already
+  } else if (layer.windowed) {
+    const Window& last = layer.window;
+    for (unsigned int y = last.y0; y < last.y0 + last.size_y; ++y) {
+      unsigned int* row = &grid(last.x0, y);
+      std::fill(row, row + last.size_x, unreachable);
+    }
+  } else {
+    grid.reset();
+  }
+  unsigned int obstacle = grid.obstacleValue();
+  for (unsigned int y = 0; y < window.size_y; ++y) {
+    unsigned int* row = &grid(window.x0, window.y0 + y);
+    for (unsigned int x = 0; x < window.size_x; ++x) {
+      unsigned int index = y * window.size_x + x;
+      unsigned char flags = window_cells_[index];
+      if (window_distance_[index] != UNREACHED) {
+        row[x] = window_distance_[index];
+      } else if ( ! (flags & PASSABLE) && (
+          ((flags & HAS_LEFT) && window_distance_[index - 1] != UNREACHED) ||
+          ((flags & HAS_RIGHT) && window_distance_[index + 1] != UNREACHED) ||
+          ((flags & HAS_DOWN) && window_distance_[index - window.size_x] != UNREACHED) ||
+          ((flags & HAS_UP) && window_distance_[index + window.size_x] != UNREACHED))) {
+        // obstacles next to a reached cell
+        row[x] = obstacle;
+      }
+    }
+  }
+  layer.windowed = true;
+  layer.window = window;
+}
+
+void MapGridEngine::pushCell(unsigned int index, int level) {
+  if (level >= int(buckets_.size())) {
+    buckets_.resize(level + 1);
+  }
+  buckets_[level].push_back(index);
+}
+
+void MapGridEngine::propagate(std::vector<int>& distance, const std::vector<unsigned char>& cells,
+    unsigned int size_x, unsigned int first_level) {
+  // breadth first from all levels at once, as MapGrid::computeTargetDistance() from the targets
+  for (unsigned int level = first_level; level < buckets_.size(); ++level) {
+    int next = level + 1;
+    if (buckets_.size() <= level + 1) {
+      buckets_.resize(level + 2);
+    }
+    const std::vector<unsigned int>& bucket = buckets_[level];
+    std::vector<unsigned int>& next_bucket = buckets_[level + 1];
+    for (unsigned int k = 0; k < bucket.size(); ++k) {
+      unsigned int index = bucket[k];
+      if (distance[index] != int(level)) {
+        continue;
+      }
+      unsigned char flags = cells[index];
+      unsigned int neighbors[4];
+      unsigned int num_neighbors = 0;
+      if (flags & HAS_LEFT) neighbors[num_neighbors++] = index - 1;
+      if (flags & HAS_RIGHT) neighbors[num_neighbors++] = index + 1;
+      if (flags & HAS_DOWN) neighbors[num_neighbors++] = index - size_x;
+      if (flags & HAS_UP) neighbors[num_neighbors++] = index + size_x;
+      for (unsigned int j = 0; j < num_neighbors; ++j) {
+        unsigned int neighbor = neighbors[j];
+        if ((cells[neighbor] & PASSABLE) && next < distance[neighbor]) {
+          distance[neighbor] = next;
+          dirty_.push_back(neighbor);
+          next_bucket.push_back(neighbor);
+        }
+      }
+    }
+    buckets_[level].clear();
+    if (next_bucket.empty() && level + 2 == buckets_.size()) {
+      // nothing left, the last bucket was only added for this level
+      buckets_.pop_back();
+    }
+  }
+}
+
+void MapGridEngine::writeCell(Layer& layer, unsigned int index) {
+  unsigned int size_x = costmap_->getSizeInCellsX();
+  const std::vector<int>& distance = layer.distance;
+  unsigned char flags = passable_[index];
+  if (distance[index] != UNREACHED) {
+    layer.grid[index] = distance[index];
+  } else if ( ! (flags & PASSABLE) && (
+      ((flags & HAS_LEFT) && distance[index - 1] != UNREACHED) ||
+      ((flags & HAS_RIGHT) && distance[index + 1] != UNREACHED) ||
+      ((flags & HAS_DOWN) && distance[index - size_x] != UNREACHED) ||
+      ((flags & HAS_UP) && distance[index + size_x] != UNREACHED))) {
+    // obstacles next to a reached cell
+    layer.grid[index] = layer.grid.obstacleValue();
+  } else {
+    layer.grid[index] = layer.grid.unreachableValue();
+  }
+}
+
+void MapGridEngine::rebuild(Layer& layer, const std::vector<unsigned int>& seeds) {
+  unsigned int size = costmap_->getSizeInCellsX() * costmap_->getSizeInCellsY();
+  layer.distance.assign(size, UNREACHED);
+  for (unsigned int i = 0; i < seeds.size(); ++i) {
+    layer.distance[seeds[i]] = 0;
+    pushCell(seeds[i], 0);
+  }
+  propagate(layer.distance, passable_, costmap_->getSizeInCellsX(), 0);
+  dirty_.clear();
+
+  layer.grid.sizeCheck(costmap_->getSizeInCellsX(), costmap_->getSizeInCellsY());
+  writeAll(layer);
+}
+
+void MapGridEngine::writeAll(Layer& layer) {
+  unsigned int size = costmap_->getSizeInCellsX() * costmap_->getSizeInCellsY();
+  for (unsigned int i = 0; i < size; ++i) {
+    writeCell(layer, i);
+  }
+}
+
+bool MapGridEngine::repair(Layer& layer, const std::vector<unsigned int>& seeds) {
+  int shift_x, shift_y;
+  if ( ! getShift(layer, shift_x, shift_y)) {
+    return false;
+  }
+  int size_x = layer.size_x;
+  int size_y = layer.size_y;
+  unsigned int size = size_x * size_y;
+  std::vector<int>& distance = layer.distance;
+
+  // move the layer onto the current map
+  bool moved = shift_x != 0 || shift_y != 0;
+  std::vector<unsigned int> old_seeds;
+  for (unsigned int i = 0; i < layer.seeds.size(); ++i) {
+    int x = int(layer.seeds[i] % size_x) - shift_x;
+    int y = int(layer.seeds[i] / size_x) - shift_y;
+    if (x >= 0 && y >= 0 && x < size_x && y < size_y) {
+      old_seeds.push_back(y * size_x + x);
+    }
+  }
+  std::sort(old_seeds.begin(), old_seeds.end());
+  if (moved) {
+    std::vector<int> moved_distance(size, UNREACHED);
+    std::vector<unsigned char> moved_passable(size, NEW_CELL);
+    int begin_x = std::max(0, -shift_x);
+    int end_x = std::min(size_x, size_x - shift_x);
+    for (int y = std::max(0, -shift_y); y < std::min(size_y, size_y - shift_y); ++y) {
+      unsigned int old_index = (y + shift_y) * size_x + begin_x + shift_x;
+      std::copy(distance.begin() + old_index, distance.begin() + old_index + (end_x - begin_x),
+          moved_distance.begin() + y * size_x + begin_x);
+      std::copy(layer.passable.begin() + old_index, layer.passable.begin() + old_index + (end_x - begin_x),
+          moved_passable.begin() + y * size_x + begin_x);
+    }
+    distance.swap(moved_distance);
+    layer.passable.swap(moved_passable);
+  }
+
+  // cells that changed, new cells included, and targets that changed
+  std::vector<unsigned int> changed;
+  for (unsigned int i = 0; i < size; ++i) {
+    if (layer.passable[i] != passable_[i]) {
+      changed.push_back(i);
+    }
+  }
+  std::vector<unsigned int> removed_seeds, added_seeds;
+  std::set_difference(old_seeds.begin(), old_seeds.end(), seeds.begin(), seeds.end(), std::back_inserter(removed_seeds));
+  std::set_difference(seeds.begin(), seeds.end(), old_seeds.begin(), old_seeds.end(), std::back_inserter(added_seeds));
+  unsigned int max_changed = size * REPAIR_MAX_CHANGED_FRACTION;
+  if (changed.size() + removed_seeds.size() + added_seeds.size() > max_changed) {
+    return false;
+  }
+
+  // cells whose distance may have lost its support: removed targets, changed cells,
+  // and the border cells, which may have been supported from cells that left the map
+  dirty_.clear();
+  for (unsigned int i = 0; i < removed_seeds.size(); ++i) {
+    pushCell(removed_seeds[i], 0);
+  }
+  for (unsigned int i = 0; i < changed.size(); ++i) {
+    if (distance[changed[i]] != UNREACHED) {
+      pushCell(changed[i], distance[changed[i]]);
+    }
+  }
+  if (moved) {
+    std::vector<unsigned int> border;
+    for (int x = 0; x < size_x; ++x) {
+      border.push_back(x);
+      border.push_back((size_y - 1) * size_x + x);
+    }
+    for (int y = 1; y < size_y - 1; ++y) {
+      border.push_back(y * size_x);
+      border.push_back(y * size_x + size_x - 1);
+    }
+    for (unsigned int i = 0; i < border.size(); ++i) {
+      if (distance[border[i]] != UNREACHED) {
+        pushCell(border[i], distance[border[i]]);
+      }
+    }
+  }
+
+  // clear level by level, a cell keeps its distance if a neighbor one level
+  // lower kept its own, which is settled once the lower level is done
+  std::vector<unsigned int> cleared;
+  for (unsigned int level = 0; level < buckets_.size(); ++level) {
+    for (unsigned int k = 0; k < buckets_[level].size(); ++k) {
+      unsigned int index = buckets_[level][k];
+      if (distance[index] != int(level)) {
+        continue;
+      }
+      unsigned char flags = passable_[index];
+      int lower = int(level) - 1;
+      bool supported;
+      if (level == 0) {
+        supported = std::binary_search(seeds.begin(), seeds.end(), index);
+      } else {
+        supported = (flags & PASSABLE) && (
+            ((flags & HAS_LEFT) && distance[index - 1] == lower) ||
+            ((flags & HAS_RIGHT) && distance[index + 1] == lower) ||
+            ((flags & HAS_DOWN) && distance[index - size_x] == lower) ||
+            ((flags & HAS_UP) && distance[index + size_x] == lower));
+      }
+      if (supported) {
+        continue;
+      }
+      distance[index] = UNREACHED;
+      cleared.push_back(index);
+      dirty_.push_back(index);
+      if (cleared.size() > max_changed) {
+        // like a moved local goal, which changes every distance
+        for (; level < buckets_.size(); ++level) {
+          buckets_[level].clear();
+        }
+        return false;
+      }
+      int higher = level + 1;
+      if ((flags & HAS_LEFT) && distance[index - 1] == higher) pushCell(index - 1, higher);
+      if ((flags & HAS_RIGHT) && distance[index + 1] == higher) pushCell(index + 1, higher);
+      if ((flags & HAS_DOWN) && distance[index - size_x] == higher) pushCell(index - size_x, higher);
+      if ((flags & HAS_UP) && distance[index + size_x] == higher) pushCell(index + size_x, higher);
+    }
+    buckets_[level].clear();
+  }
+
+  // propagate again from the targets and from the reached cells around cleared, changed and new cells
+  for (unsigned int i = 0; i < seeds.size(); ++i) {
+    if (distance[seeds[i]] != 0) {
+      distance[seeds[i]] = 0;
+      dirty_.push_back(seeds[i]);
+      pushCell(seeds[i], 0);
+    }
+  }
+  cleared.insert(cleared.end(), changed.begin(), changed.end());
+  for (unsigned int i = 0; i < cleared.size(); ++i) {
+    unsigned int index = cleared[i];
+    unsigned char flags = passable_[index];
+    if ((flags & HAS_LEFT) && distance[index - 1] != UNREACHED) pushCell(index - 1, distance[index - 1]);
+    if ((flags & HAS_RIGHT) && distance[index + 1] != UNREACHED) pushCell(index + 1, distance[index + 1]);
+    if ((flags & HAS_DOWN) && distance[index - size_x] != UNREACHED) pushCell(index - size_x, distance[index - size_x]);
+    if ((flags & HAS_UP) && distance[index + size_x] != UNREACHED) pushCell(index + size_x, distance[index + size_x]);
+  }
+  propagate(layer.distance, passable_, costmap_->getSizeInCellsX(), 0);
+
+  // write the cells whose value may have changed, all of them if the map moved
+  if (moved) {
+    writeAll(layer);
+    return true;
+  }
+  dirty_.insert(dirty_.end(), changed.begin(), changed.end());
+  for (unsigned int i = 0; i < dirty_.size(); ++i) {
+    // obstacle values depend on the neighbors
+    unsigned int index = dirty_[i];
+    unsigned char flags = passable_[index];
+    writeCell(layer, index);
+    if (flags & HAS_LEFT) writeCell(layer, index - 1);
+    if (flags & HAS_RIGHT) writeCell(layer, index + 1);
+    if (flags & HAS_DOWN) writeCell(layer, index - size_x);
+    if (flags & HAS_UP) writeCell(layer, index + size_x);
+  }
+  return true;
+}
+
+} /* namespace base_local_planner */
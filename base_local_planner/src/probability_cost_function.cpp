@@ -7,23 +7,88 @@
 #include <base_local_planner/probability_cost_function.h>
 
 #include <math.h>
+#include <algorithm>
 
 
 namespace base_local_planner {
 
-void ProbabilityCostFunction::setDirectionProbability(std::vector<double> & arr){
+namespace {
+// bin of the direction of a trajectory in a histogram of num_bins equal angles from the heading
+inline unsigned int directionBin(double thetav, unsigned int num_bins) {
+  double angle = fmod(thetav, 2 * M_PI);
+  if (angle < 0.0) {
+    angle += 2 * M_PI;
+  }
+  return std::min((unsigned int)(angle / (2 * M_PI) * num_bins), num_bins - 1);
+}
+}
+
+void ProbabilityCostFunction::setDirectionProbability(const std::vector<double> & arr){
     vec_.clear();
     vec_ = arr;
 }
 
+void ProbabilityCostFunction::setPolarProbability(const PolarProbability& polar) {
+  polar_probability_ = polar;
+  cos_yaw_ = cos(polar.origin_yaw);
+  sin_yaw_ = sin(polar.origin_yaw);
+}
+
+double ProbabilityCostFunction::polarCost(Trajectory &traj) const {
+  const PolarProbability& polar = polar_probability_;
+  if (polar.probability.empty() || polar.range_bins == 0) {
+    return 0.0;
+  }
+  unsigned int num_bearings = polar.probability.size() / polar.range_bins;
+  double point_discount = pow(discount_, traj.time_delta_);
+  double discount = 1.0;
+  double cost = 0.0;
+  double px, py, pth;
+  for (unsigned int i = 0; i < traj.getPointsSize(); ++i) {
+    traj.getPoint(i, px, py, pth);
+    // the point in the frame of the origin
+    double dx = px - polar.origin_x, dy = py - polar.origin_y;
+    double x = dx * cos_yaw_ + dy * sin_yaw_;
+    double y = dy * cos_yaw_ - dx * sin_yaw_;
+    unsigned int bearing = directionBin(atan2(y, x), num_bearings);
+    // points beyond the table are as likely to collide as those at its edge
+    unsigned int range = std::min((unsigned int)(sqrt(x * x + y * y) / polar.range_resolution), polar.range_bins - 1);
+    cost = std::max(cost, discount * polar.probability[bearing * polar.range_bins + range]);
+    discount *= point_discount;
+  }
+  return cost;
+}
+
 double ProbabilityCostFunction::scoreTrajectory(Trajectory &traj) {
+  // no member state is written here, trajectories may be scored concurrently
+  if (polar_) {
+    return polarCost(traj);
+  }
+  if (vec_.empty()) {
+    // no scan yet, every direction is safe
+    return 1.0;
+  }
+  return vec_[directionBin(traj.thetav_, vec_.size())];
+}
 
-  double thetav_degree = traj.thetav_ * 180 / M_PI;
-  if(thetav_degree < 0.0){
-      thetav_degree += 360.0;
+void ProbabilityCostFunction::scoreTrajectories(std::vector<Trajectory>& trajs,
+    const std::vector<unsigned int>& indices, std::vector<double>& costs) {
+  costs.resize(indices.size());
+  if (polar_) {
+    for (unsigned int k = 0; k < indices.size(); ++k) {
+      costs[k] = polarCost(trajs[indices[k]]);
+    }
+    return;
+  }
+  if (vec_.empty()) {
+    costs.assign(indices.size(), 1.0);
+    return;
+  }
+  const double* vec = &vec_[0];
+  unsigned int num_bins = vec_.size();
+  for (unsigned int k = 0; k < indices.size(); ++k) {
+    costs[k] = vec[directionBin(trajs[indices[k]].thetav_, num_bins)];
   }
-  cost_ = vec_[int(thetav_degree)];
-  return cost_;
 }
 
 } /* namespace base_local_planner */
@@ -0,0 +1,128 @@
+/*
+ * adaptive_trajectory_generator_test.cpp
+ *
+ *      Author: Jeeseon Kim
+ */
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+
+#include <base_local_planner/adaptive_trajectory_generator.h>
+
+namespace base_local_planner {
+
+namespace {
+
+const double CACHE_RESOLUTION = 0.05;
+
+LocalPlannerLimits makeLimits() {
+  LocalPlannerLimits limits;
+  limits.max_trans_vel = 0.55;
+  limits.min_trans_vel = 0.1;
+  limits.max_vel_x = 0.55;
+  limits.min_vel_x = -0.1;
+  limits.max_vel_y = 0.1;
+  limits.min_vel_y = -0.1;
+  limits.max_rot_vel = 1.0;
+  limits.min_rot_vel = 0.4;
+  limits.acc_lim_x = 2.5;
+  limits.acc_lim_y = 2.5;
+  limits.acc_lim_theta = 3.2;
+  limits.acc_limit_trans = 2.5;
+  return limits;
+}
+
+/**
+ * A trajectory taken from the cache against direct integration of the same velocity
+ */
+void expectSameRollout(AdaptiveTrajectoryGenerator& generator, const Eigen::Vector3f& pos,
+    const Eigen::Vector3f& vel, const Eigen::Vector3f& sample_vel) {
+  Trajectory cached, direct;
+  bool cached_valid = generator.generateTrajectory(pos, vel, sample_vel, cached);
+  bool direct_valid = generator.SimpleTrajectoryGenerator::generateTrajectory(pos, vel, sample_vel, direct);
+  ASSERT_EQ(direct_valid, cached_valid) << sample_vel.transpose();
+  if (!direct_valid) {
+    return;
+  }
+  EXPECT_DOUBLE_EQ(direct.time_delta_, cached.time_delta_);
+  EXPECT_FLOAT_EQ(direct.xv_, cached.xv_);
+  EXPECT_FLOAT_EQ(direct.yv_, cached.yv_);
+  EXPECT_FLOAT_EQ(direct.thetav_, cached.thetav_);
+  ASSERT_EQ(direct.getPointsSize(), cached.getPointsSize()) << sample_vel.transpose();
+  for (unsigned int i = 0; i < direct.getPointsSize(); ++i) {
+    double dx, dy, dth, cx, cy, cth;
+    direct.getPoint(i, dx, dy, dth);
+    cached.getPoint(i, cx, cy, cth);
+    EXPECT_NEAR(dx, cx, 1e-4) << sample_vel.transpose() << " point " << i;
+    EXPECT_NEAR(dy, cy, 1e-4) << sample_vel.transpose() << " point " << i;
+    EXPECT_NEAR(dth, cth, 1e-4) << sample_vel.transpose() << " point " << i;
+  }
+}
+
+}
+
+TEST(AdaptiveTrajectoryGeneratorTest, cachedAndMirroredRolloutsMatchIntegration) {
+  LocalPlannerLimits limits = makeLimits();
+  AdaptiveTrajectoryGenerator generator;
+  generator.setParameters(1.7, 0.025, 0.1, true, 0.2);
+  generator.setRolloutCache(CACHE_RESOLUTION);
+  Eigen::Vector3f pos(1.0, 2.0, 0.8), vel(0.2, 0.0, 0.3), goal(3.0, 2.0, 0.0);
+  generator.initialise(pos, vel, goal, &limits, Eigen::Vector3f(7, 3, 11));
+
+  // a left turn first, then its mirror image from the cache, and the other way around
+  float velocities[][3] = {{0.3f, 0.05f, 0.5f}, {0.3f, -0.05f, -0.5f},
+                           {0.15f, 0.0f, -0.85f}, {0.15f, 0.0f, 0.85f},
+                           {0.0f, 0.0f, 0.0f}, {0.5f, 0.1f, 0.0f}};
+  for (int k = 0; k < 6; ++k) {
+    Eigen::Vector3f sample_vel(velocities[k][0], velocities[k][1], velocities[k][2]);
+    for (int d = 0; d < 3; ++d) {
+      sample_vel[d] = float(int(floor(sample_vel[d] / CACHE_RESOLUTION + 0.5)) * CACHE_RESOLUTION);
+    }
+    expectSameRollout(generator, pos, vel, sample_vel);
+    // from the cache again, at another pose
+    expectSameRollout(generator, Eigen::Vector3f(-0.5, 0.3, -2.4), vel, sample_vel);
+  }
+
+  // the samples are snapped to the lattice, inside the window and otherwise the same rollouts
+  unsigned int num_samples = 0;
+  while (generator.hasMoreTrajectories()) {
+    Trajectory traj;
+    if (generator.nextTrajectory(traj)) {
+      Eigen::Vector3f sample_vel(traj.xv_, traj.yv_, traj.thetav_);
+      for (int d = 0; d < 3; ++d) {
+        double k = sample_vel[d] / CACHE_RESOLUTION;
+        EXPECT_NEAR(k, floor(k + 0.5), 1e-4) << sample_vel.transpose();
+      }
+      EXPECT_LE(traj.xv_, limits.max_vel_x + 1e-6);
+      EXPECT_GE(traj.xv_, limits.min_vel_x - 1e-6);
+      EXPECT_LE(fabs(traj.thetav_), limits.max_rot_vel + 1e-6);
+      expectSameRollout(generator, pos, vel, sample_vel);
+      ++num_samples;
+    }
+  }
+  EXPECT_GT(num_samples, 0u);
+}
+
+TEST(AdaptiveTrajectoryGeneratorTest, setParametersClearsTheCache) {
+  LocalPlannerLimits limits = makeLimits();
+  AdaptiveTrajectoryGenerator generator;
+  generator.setParameters(1.7, 0.025, 0.1, true, 0.2);
+  generator.setRolloutCache(CACHE_RESOLUTION);
+  Eigen::Vector3f pos(1.0, 2.0, 0.8), vel(0.2, 0.0, 0.3), goal(3.0, 2.0, 0.0);
+  generator.initialise(pos, vel, goal, &limits, Eigen::Vector3f(7, 3, 11));
+  Eigen::Vector3f sample_vel(0.3f, 0.0f, 0.5f);
+  Trajectory before;
+  ASSERT_TRUE(generator.generateTrajectory(pos, vel, sample_vel, before));
+
+  // a shorter simulation time, the rollout of the same velocity must follow it
+  generator.setParameters(0.8, 0.025, 0.1, true, 0.2);
+  generator.initialise(pos, vel, goal, &limits, Eigen::Vector3f(7, 3, 11));
+  Trajectory after;
+  ASSERT_TRUE(generator.generateTrajectory(pos, vel, sample_vel, after));
+  EXPECT_LT(after.getPointsSize(), before.getPointsSize());
+  expectSameRollout(generator, pos, vel, sample_vel);
+  expectSameRollout(generator, pos, vel, Eigen::Vector3f(0.3f, 0.0f, -0.5f));
+}
+
+} /* namespace base_local_planner */
@@ -0,0 +1,200 @@
+/*
+ * costmap_pyramid_test.cpp
+ *
+ *      Author: Jeeseon Kim
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include <costmap_2d/cost_values.h>
+#include <base_local_planner/costmap_pyramid.h>
+#include <base_local_planner/costmap_snapshot.h>
+#include <base_local_planner/batch_obstacle_cost_function.h>
+
+namespace base_local_planner {
+
+namespace {
+
+const double RESOLUTION = 0.05;
+
+/**
+ * Scatter blobs of inflated cost, with a lethal center, over a costmap
+ */
+void scatterObstacles(costmap_2d::Costmap2D& costmap, unsigned int seed, int num_obstacles) {
+  srand(seed);
+  int size_x = costmap.getSizeInCellsX(), size_y = costmap.getSizeInCellsY();
+  for (int k = 0; k < num_obstacles; ++k) {
+    int x = rand() % size_x, y = rand() % size_y;
+    for (int dy = -4; dy <= 4; ++dy) {
+      for (int dx = -4; dx <= 4; ++dx) {
+        if (x + dx < 0 || y + dy < 0 || x + dx >= size_x || y + dy >= size_y) {
+          continue;
+        }
+        int d = abs(dx) + abs(dy);
+        unsigned char cost = d == 0 ? costmap_2d::LETHAL_OBSTACLE :
+            d < 2 ? costmap_2d::INSCRIBED_INFLATED_OBSTACLE : (unsigned char)std::max(0, 200 - d * 25);
+        if (cost > costmap.getCost(x + dx, y + dy)) {
+          costmap.setCost(x + dx, y + dy, cost);
+        }
+      }
+    }
+  }
+}
+
+unsigned char bruteForceMax(const costmap_2d::Costmap2D& costmap,
+    unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1) {
+  unsigned char max_cost = 0;
+  for (unsigned int y = y0; y <= y1; ++y) {
+    for (unsigned int x = x0; x <= x1; ++x) {
+      max_cost = std::max(max_cost, costmap.getCost(x, y));
+    }
+  }
+  return max_cost;
+}
+
+std::vector<geometry_msgs::Point> makeFootprint() {
+  std::vector<geometry_msgs::Point> footprint;
+  double corners[4][2] = {{0.2, 0.15}, {0.2, -0.15}, {-0.2, -0.15}, {-0.2, 0.15}};
+  for (int i = 0; i < 4; ++i) {
+    geometry_msgs::Point p;
+    p.x = corners[i][0];
+    p.y = corners[i][1];
+    footprint.push_back(p);
+  }
+  return footprint;
+}
+
+/**
+ * Arcs from a pose, for a range of translational and rotational velocities
+ */
+std::vector<Trajectory> makeArcs(double x, double y, double th) {
+  std::vector<Trajectory> trajs;
+  for (int a = 0; a < 6; ++a) {
+    for (int b = 0; b < 9; ++b) {
+      Trajectory traj;
+      traj.xv_ = 0.1 * a;
+      traj.yv_ = 0.0;
+      traj.thetav_ = -1.0 + 0.25 * b;
+      double px = x, py = y, pth = th;
+      for (int k = 0; k < 17; ++k) {
+        traj.addPoint(px, py, pth);
+        px += traj.xv_ * cos(pth) * 0.1;
+        py += traj.xv_ * sin(pth) * 0.1;
+        pth += traj.thetav_ * 0.1;
+      }
+      trajs.push_back(traj);
+    }
+  }
+  return trajs;
+}
+
+}
+
+TEST(CostmapPyramidTest, atMostMatchesBruteForce) {
+  costmap_2d::Costmap2D costmap(100, 90, RESOLUTION, 0.0, 0.0);
+  scatterObstacles(costmap, 1, 12);
+  CostmapPyramid pyramid;
+  pyramid.build(costmap);
+
+  srand(1);
+  unsigned int proven = 0;
+  for (int k = 0; k < 5000; ++k) {
+    unsigned int x0 = rand() % 100, y0 = rand() % 90;
+    unsigned int x1 = std::min(99u, x0 + rand() % 20), y1 = std::min(89u, y0 + rand() % 20);
+    unsigned char cost = rand() % 256;
+    if (pyramid.atMost(x0, y0, x1, y1, cost)) {
+      // never claims a bound that does not hold
+      EXPECT_LE(bruteForceMax(costmap, x0, y0, x1, y1), cost);
+      ++proven;
+    }
+  }
+  EXPECT_GT(proven, 0u);
+
+  // boxes of whole coarse cells are decided by the coarse levels alone
+  for (unsigned int y0 = 0; y0 + 8 <= 90; y0 += 8) {
+    for (unsigned int x0 = 0; x0 + 16 <= 100; x0 += 8) {
+      unsigned char max_cost = bruteForceMax(costmap, x0, y0, x0 + 15, y0 + 7);
+      EXPECT_TRUE(pyramid.atMost(x0, y0, x0 + 15, y0 + 7, max_cost));
+      if (max_cost > 0) {
+        EXPECT_FALSE(pyramid.atMost(x0, y0, x0 + 15, y0 + 7, max_cost - 1));
+      }
+    }
+  }
+}
+
+TEST(BatchObstacleCostFunctionTest, poseAtMostBoundsPoseCost) {
+  costmap_2d::Costmap2D costmap(80, 80, RESOLUTION, 0.0, 0.0);
+  scatterObstacles(costmap, 2, 20);
+  BatchObstacleCostFunction critic(&costmap);
+  critic.setFootprint(makeFootprint());
+  critic.setParams(0.55, 0.2, 0.25);
+  critic.setPyramid(true);
+  critic.prepare();
+
+  srand(2);
+  unsigned int proven = 0;
+  for (int k = 0; k < 5000; ++k) {
+    unsigned int cell_x = rand() % 80, cell_y = rand() % 80;
+    double cost = rand() % 256;
+    if (critic.poseAtMost(cell_x, cell_y, cost)) {
+      ++proven;
+      // anywhere in the cell and at any heading
+      double x = (cell_x + double(rand()) / RAND_MAX) * RESOLUTION;
+      double y = (cell_y + double(rand()) / RAND_MAX) * RESOLUTION;
+      double th = 2 * M_PI * rand() / RAND_MAX;
+      double pose_cost = critic.poseCost(x, y, th);
+      EXPECT_GE(pose_cost, 0.0);
+      EXPECT_LE(pose_cost, cost);
+    }
+  }
+  EXPECT_GT(proven, 0u);
+}
+
+TEST(BatchObstacleCostFunctionTest, pyramidKeepsTrajectoryCosts) {
+  for (unsigned int seed = 1; seed <= 5; ++seed) {
+    costmap_2d::Costmap2D costmap(120, 120, RESOLUTION, 0.0, 0.0);
+    scatterObstacles(costmap, seed, 30);
+    BatchObstacleCostFunction critic(&costmap);
+    critic.setFootprint(makeFootprint());
+    critic.setParams(0.55, 0.2, 0.25);
+    CostmapSnapshot snapshot;
+
+    srand(seed);
+    std::vector<Trajectory> trajs;
+    for (int k = 0; k < 5; ++k) {
+      std::vector<Trajectory> arcs = makeArcs(1.5 + 3.0 * rand() / RAND_MAX, 1.5 + 3.0 * rand() / RAND_MAX,
+          2 * M_PI * rand() / RAND_MAX);
+      trajs.insert(trajs.end(), arcs.begin(), arcs.end());
+    }
+
+    // every combination of summed costs, a snapshot and distance fields
+    for (int mode = 0; mode < 8; ++mode) {
+      bool sum_scores = mode & 1, use_snapshot = mode & 2, distance_field = mode & 4;
+      critic.setSumScores(sum_scores);
+      critic.setDistanceField(distance_field);
+      critic.setSnapshot(use_snapshot ? &snapshot : NULL);
+      if (use_snapshot) {
+        // a window that some of the trajectories leave
+        snapshot.take(costmap, 3.0, 3.0, 2.0);
+      }
+      critic.setPyramid(false);
+      critic.prepare();
+      std::vector<double> expected;
+      for (unsigned int i = 0; i < trajs.size(); ++i) {
+        expected.push_back(critic.scoreTrajectory(trajs[i]));
+      }
+      critic.setPyramid(true);
+      critic.prepare();
+      for (unsigned int i = 0; i < trajs.size(); ++i) {
+        EXPECT_EQ(expected[i], critic.scoreTrajectory(trajs[i])) << "mode " << mode << " trajectory " << i;
+      }
+    }
+  }
+}
+
+} /* namespace base_local_planner */
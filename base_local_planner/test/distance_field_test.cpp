@@ -0,0 +1,163 @@
+/*
+ * distance_field_test.cpp
+ *
+ *      Author: Jeeseon Kim
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include <costmap_2d/cost_values.h>
+#include <base_local_planner/distance_field.h>
+#include <base_local_planner/batch_obstacle_cost_function.h>
+
+namespace base_local_planner {
+
+namespace {
+
+const double RESOLUTION = 0.05;
+
+/**
+ * Scatter blobs of cost, with a lethal or unknown center, over a costmap
+ */
+void scatterObstacles(costmap_2d::Costmap2D& costmap, unsigned int seed, int num_obstacles) {
+  srand(seed);
+  int size_x = costmap.getSizeInCellsX(), size_y = costmap.getSizeInCellsY();
+  for (int k = 0; k < num_obstacles; ++k) {
+    int x = rand() % size_x, y = rand() % size_y;
+    unsigned char center = rand() % 4 == 0 ? costmap_2d::NO_INFORMATION : costmap_2d::LETHAL_OBSTACLE;
+    for (int dy = -3; dy <= 3; ++dy) {
+      for (int dx = -3; dx <= 3; ++dx) {
+        if (x + dx < 0 || y + dy < 0 || x + dx >= size_x || y + dy >= size_y) {
+          continue;
+        }
+        int d = abs(dx) + abs(dy);
+        unsigned char cost = d == 0 ? center : d < 2 ? costmap_2d::INSCRIBED_INFLATED_OBSTACLE : (unsigned char)std::max(0, 200 - d * 40);
+        if (cost > costmap.getCost(x + dx, y + dy) && costmap.getCost(x + dx, y + dy) != costmap_2d::NO_INFORMATION) {
+          costmap.setCost(x + dx, y + dy, cost);
+        }
+      }
+    }
+  }
+}
+
+/**
+ * Distance to the nearest cell with at least min_cost, by looking at all of them
+ */
+double bruteForceDistance(const costmap_2d::Costmap2D& costmap, unsigned int x, unsigned int y,
+    unsigned char min_cost, bool off_map_obstacles) {
+  int size_x = costmap.getSizeInCellsX(), size_y = costmap.getSizeInCellsY();
+  double best = 1e9;
+  for (int b = -1; b <= size_y; ++b) {
+    for (int a = -1; a <= size_x; ++a) {
+      bool on_map = a >= 0 && b >= 0 && a < size_x && b < size_y;
+      bool obstacle = on_map ? costmap.getCost(a, b) >= min_cost : off_map_obstacles;
+      if (obstacle) {
+        best = std::min(best, hypot(a - double(x), b - double(y)));
+      }
+    }
+  }
+  return best;
+}
+
+std::vector<geometry_msgs::Point> makeFootprint() {
+  std::vector<geometry_msgs::Point> footprint;
+  double corners[4][2] = {{0.2, 0.15}, {0.2, -0.15}, {-0.2, -0.15}, {-0.2, 0.15}};
+  for (int i = 0; i < 4; ++i) {
+    geometry_msgs::Point p;
+    p.x = corners[i][0];
+    p.y = corners[i][1];
+    footprint.push_back(p);
+  }
+  return footprint;
+}
+
+}
+
+TEST(DistanceFieldTest, matchesBruteForce) {
+  for (unsigned int seed = 1; seed <= 3; ++seed) {
+    costmap_2d::Costmap2D costmap(40, 30, RESOLUTION, 0.0, 0.0);
+    scatterObstacles(costmap, seed, 6);
+    unsigned char min_costs[] = {1, costmap_2d::LETHAL_OBSTACLE};
+    for (int c = 0; c < 2; ++c) {
+      for (int off_map = 0; off_map < 2; ++off_map) {
+        DistanceField field;
+        field.compute(costmap, min_costs[c], off_map);
+        for (unsigned int y = 0; y < 30; ++y) {
+          for (unsigned int x = 0; x < 40; ++x) {
+            double expected = bruteForceDistance(costmap, x, y, min_costs[c], off_map);
+            if (expected < 1e8) {
+              EXPECT_NEAR(expected, field.getDistance(x, y), 1e-4) << "cell " << x << ", " << y;
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST(DistanceFieldTest, emptyMapIsFar) {
+  costmap_2d::Costmap2D costmap(20, 10, RESOLUTION, 0.0, 0.0);
+  DistanceField field;
+  field.compute(costmap, 1, false);
+  EXPECT_GT(field.getDistance(5, 5), 1000.0);
+  field.compute(costmap, 1, true);
+  // the map border is one cell beyond the edge cells
+  EXPECT_FLOAT_EQ(1.0f, field.getDistance(0, 5));
+  EXPECT_FLOAT_EQ(5.0f, field.getDistance(10, 5));
+}
+
+TEST(BatchObstacleCostFunctionTest, distanceFieldAcceptsExactlyAndRejectsCollisions) {
+  unsigned int accepted = 0;
+  for (unsigned int seed = 1; seed <= 10; ++seed) {
+    costmap_2d::Costmap2D costmap(80, 80, RESOLUTION, 0.0, 0.0);
+    scatterObstacles(costmap, seed, 15);
+    BatchObstacleCostFunction critic(&costmap);
+    critic.setFootprint(makeFootprint());
+    critic.setParams(0.55, 0.2, 0.25);
+    double inscribed_radius = 0.15;
+
+    srand(seed);
+    std::vector<double> xs, ys, ths, exact;
+    critic.setDistanceField(false);
+    critic.prepare();
+    for (int k = 0; k < 500; ++k) {
+      xs.push_back(0.3 + 3.4 * rand() / RAND_MAX);
+      ys.push_back(0.3 + 3.4 * rand() / RAND_MAX);
+      ths.push_back(2 * M_PI * rand() / RAND_MAX);
+      exact.push_back(critic.poseCost(xs[k], ys[k], ths[k]));
+    }
+    critic.setDistanceField(true);
+    critic.prepare();
+    for (int k = 0; k < 500; ++k) {
+      double x = xs[k], y = ys[k], th = ths[k];
+      double cost = critic.poseCost(x, y, th);
+
+      if (cost >= 0) {
+        // accepting is exact
+        EXPECT_EQ(exact[k], cost) << "pose " << x << ", " << y << ", " << th;
+        accepted += cost == 0.0 && exact[k] == 0.0;
+      } else if (exact[k] >= 0) {
+        // rejecting is stricter than the footprint check, but only for a lethal or unknown cell under the footprint
+        bool collides = false;
+        for (unsigned int cy = 0; cy < 80; ++cy) {
+          for (unsigned int cx = 0; cx < 80; ++cx) {
+            unsigned char c = costmap.getCost(cx, cy);
+            if ((c == costmap_2d::LETHAL_OBSTACLE || c == costmap_2d::NO_INFORMATION) &&
+                hypot((cx + 0.5) * RESOLUTION - x, (cy + 0.5) * RESOLUTION - y) < inscribed_radius) {
+              collides = true;
+            }
+          }
+        }
+        EXPECT_TRUE(collides) << "pose " << x << ", " << y << ", " << th;
+      }
+    }
+  }
+  EXPECT_GT(accepted, 0u);
+}
+
+} /* namespace base_local_planner */
@@ -0,0 +1,270 @@
+/*
+ * map_grid_engine_test.cpp
+ *
+ *      Author: Jeeseon Kim
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include <costmap_2d/cost_values.h>
+#include <base_local_planner/map_grid.h>
+#include <base_local_planner/map_grid_engine.h>
+#include <base_local_planner/compact_map_grid.h>
+
+namespace base_local_planner {
+
+namespace {
+
+const unsigned int SIZE = 100;
+const double RESOLUTION = 0.05;
+
+/**
+ * Cost of a cell of a fixed random world, by its global cell coordinates:
+ * blocks of lethal, inscribed, unknown and medium cost cells
+ */
+unsigned char worldCost(int gx, int gy, unsigned int seed) {
+  unsigned int h = (unsigned int)(gx / 5) * 73856093u ^ (unsigned int)(gy / 5) * 19349663u ^ seed * 83492791u;
+  h *= 2654435761u;
+  if ((h >> 24) >= 40) {
+    return costmap_2d::FREE_SPACE;
+  }
+  if ((gx % 5) < 3 && (gy % 5) < 3) {
+    return (h >> 20) & 1 ? costmap_2d::LETHAL_OBSTACLE : costmap_2d::NO_INFORMATION;
+  }
+  return (h >> 19) & 1 ? costmap_2d::INSCRIBED_INFLATED_OBSTACLE : 100;
+}
+
+/**
+ * Fill a costmap whose origin is at the given global cell from the world
+ */
+void fillCostmap(costmap_2d::Costmap2D& costmap, int origin_x, int origin_y, unsigned int seed) {
+  costmap.updateOrigin(origin_x * RESOLUTION, origin_y * RESOLUTION);
+  for (unsigned int y = 0; y < costmap.getSizeInCellsY(); ++y) {
+    for (unsigned int x = 0; x < costmap.getSizeInCellsX(); ++x) {
+      costmap.setCost(x, y, worldCost(origin_x + x, origin_y + y, seed));
+    }
+  }
+}
+
+/**
+ * A wavy plan along x, from x_start on
+ */
+std::vector<geometry_msgs::PoseStamped> makePlan(double x_start, double x_end, double y, double amplitude) {
+  std::vector<geometry_msgs::PoseStamped> plan;
+  for (double x = x_start; x < x_end; x += 0.025) {
+    geometry_msgs::PoseStamped pose;
+    pose.pose.position.x = x;
+    pose.pose.position.y = y + amplitude * sin(x * 2.0);
+    plan.push_back(pose);
+  }
+  return plan;
+}
+
+/**
+ * The number of cells whose values differ from a MapGrid propagated for the same targets
+ */
+unsigned int countDifferences(const CompactMapGrid& layer, costmap_2d::Costmap2D& costmap,
+    const std::vector<geometry_msgs::PoseStamped>& plan, bool is_local_goal) {
+  MapGrid reference;
+  reference.sizeCheck(costmap.getSizeInCellsX(), costmap.getSizeInCellsY());
+  reference.resetPathDist();
+  if (is_local_goal) {
+    reference.setLocalGoal(costmap, plan);
+  } else {
+    reference.setTargetCells(costmap, plan);
+  }
+  unsigned int differences = 0;
+  for (unsigned int y = 0; y < costmap.getSizeInCellsY(); ++y) {
+    for (unsigned int x = 0; x < costmap.getSizeInCellsX(); ++x) {
+      if (layer.getCellCosts(x, y) != reference(x, y).target_dist) {
+        ++differences;
+      }
+    }
+  }
+  return differences;
+}
+
+}
+
+TEST(MapGridEngineTest, rebuildMatchesMapGrid) {
+  for (unsigned int seed = 1; seed <= 10; ++seed) {
+    costmap_2d::Costmap2D costmap(SIZE, SIZE, RESOLUTION, 0.0, 0.0);
+    fillCostmap(costmap, 0, 0, seed);
+    std::vector<geometry_msgs::PoseStamped> plan = makePlan(0.1, 4.9, 1.0 + 0.3 * seed, 0.5);
+    MapGridEngine engine(&costmap);
+    engine.reset();
+    EXPECT_EQ(0u, countDifferences(*engine.getLayer(plan, false), costmap, plan, false));
+    EXPECT_EQ(0u, countDifferences(*engine.getLayer(plan, true), costmap, plan, true));
+    EXPECT_EQ(2u, engine.getNumPropagations());
+  }
+}
+
+TEST(MapGridEngineTest, sameTargetsShareLayer) {
+  costmap_2d::Costmap2D costmap(SIZE, SIZE, RESOLUTION, 0.0, 0.0);
+  fillCostmap(costmap, 0, 0, 1);
+  std::vector<geometry_msgs::PoseStamped> plan = makePlan(0.1, 4.9, 2.5, 0.5);
+  MapGridEngine engine(&costmap);
+  engine.reset();
+  const CompactMapGrid* path = engine.getLayer(plan, false);
+  EXPECT_EQ(path, engine.getLayer(plan, false));
+  EXPECT_NE(path, engine.getLayer(plan, true));
+  EXPECT_EQ(2u, engine.getNumPropagations());
+}
+
+TEST(MapGridEngineTest, repairAfterShift) {
+  costmap_2d::Costmap2D costmap(SIZE, SIZE, RESOLUTION, 0.0, 0.0);
+  MapGridEngine engine(&costmap);
+  engine.setIncremental(true);
+  std::vector<geometry_msgs::PoseStamped> global_plan = makePlan(0.0, 20.0, 2.5, 0.8);
+  unsigned int differences = 0;
+  for (int cycle = 0; cycle < 40; ++cycle) {
+    // the robot drives along the plan and the rolling costmap follows it
+    int origin_x = cycle, origin_y = cycle / 4;
+    fillCostmap(costmap, origin_x, origin_y, 3);
+    double robot_x = origin_x * RESOLUTION + 1.0;
+    std::vector<geometry_msgs::PoseStamped> plan;
+    for (unsigned int i = 0; i < global_plan.size(); ++i) {
+      if (global_plan[i].pose.position.x >= robot_x) {
+        plan.push_back(global_plan[i]);
+      }
+    }
+    engine.reset();
+    differences += countDifferences(*engine.getLayer(plan, false), costmap, plan, false);
+    differences += countDifferences(*engine.getLayer(plan, true), costmap, plan, true);
+  }
+  EXPECT_EQ(0u, differences);
+  EXPECT_GT(engine.getNumRepairs(), 0u);
+}
+
+TEST(MapGridEngineTest, repairAfterCostChanges) {
+  costmap_2d::Costmap2D costmap(SIZE, SIZE, RESOLUTION, 0.0, 0.0);
+  fillCostmap(costmap, 0, 0, 4);
+  MapGridEngine engine(&costmap);
+  engine.setIncremental(true);
+  std::vector<geometry_msgs::PoseStamped> plan = makePlan(0.1, 4.9, 2.5, 0.5);
+  srand(4);
+  unsigned int differences = 0;
+  for (int cycle = 0; cycle < 40; ++cycle) {
+    // obstacles appear and disappear, some of them on the plan
+    for (int k = 0; k < 20; ++k) {
+      unsigned int x = rand() % SIZE, y = rand() % SIZE;
+      unsigned char costs[] = {costmap_2d::FREE_SPACE, 100, costmap_2d::INSCRIBED_INFLATED_OBSTACLE,
+          costmap_2d::LETHAL_OBSTACLE, costmap_2d::NO_INFORMATION};
+      costmap.setCost(x, y, costs[rand() % 5]);
+    }
+    engine.reset();
+    differences += countDifferences(*engine.getLayer(plan, false), costmap, plan, false);
+    differences += countDifferences(*engine.getLayer(plan, true), costmap, plan, true);
+  }
+  EXPECT_EQ(0u, differences);
+  EXPECT_GT(engine.getNumRepairs(), 0u);
+}
+
+TEST(MapGridEngineTest, repairAfterTargetChanges) {
+  costmap_2d::Costmap2D costmap(SIZE, SIZE, RESOLUTION, 0.0, 0.0);
+  fillCostmap(costmap, 0, 0, 5);
+  MapGridEngine engine(&costmap);
+  engine.setIncremental(true);
+  unsigned int differences = 0;
+  for (int cycle = 0; cycle < 40; ++cycle) {
+    // the plan is consumed from its start and replanned slightly differently
+    std::vector<geometry_msgs::PoseStamped> plan = makePlan(0.1 + 0.05 * cycle, 4.9, 2.5 + 0.01 * (cycle % 5), 0.5);
+    engine.reset();
+    differences += countDifferences(*engine.getLayer(plan, false), costmap, plan, false);
+    differences += countDifferences(*engine.getLayer(plan, true), costmap, plan, true);
+  }
+  EXPECT_EQ(0u, differences);
+  EXPECT_GT(engine.getNumRepairs(), 0u);
+}
+
+TEST(CompactMapGridTest, lookupsMatchMapGrid) {
+  costmap_2d::Costmap2D costmap(SIZE, SIZE / 2, RESOLUTION, 0.0, 0.0);
+  fillCostmap(costmap, 0, 0, 6);
+  std::vector<geometry_msgs::PoseStamped> plan = makePlan(0.1, 4.9, 1.2, 0.5);
+  MapGridEngine engine(&costmap);
+  engine.reset();
+  const CompactMapGrid* layer = engine.getLayer(plan, false);
+
+  MapGrid reference;
+  reference.sizeCheck(SIZE, SIZE / 2);
+  reference.resetPathDist();
+  reference.setTargetCells(costmap, plan);
+  ASSERT_EQ(SIZE, layer->getSizeX());
+  ASSERT_EQ(SIZE / 2, layer->getSizeY());
+  EXPECT_EQ(reference.obstacleCosts(), layer->obstacleCosts());
+  EXPECT_EQ(reference.unreachableCellCosts(), layer->unreachableCellCosts());
+  unsigned int obstacles = 0;
+  for (unsigned int y = 0; y < SIZE / 2; ++y) {
+    for (unsigned int x = 0; x < SIZE; ++x) {
+      EXPECT_EQ(reference(x, y).target_dist, layer->getCellCosts(x, y));
+      if (layer->getCellCosts(x, y) == layer->obstacleCosts()) {
+        ++obstacles;
+      }
+    }
+  }
+  EXPECT_GT(obstacles, 0u);
+}
+
+TEST(CompactMapGridTest, sizeCheckAndReset) {
+  CompactMapGrid grid;
+  EXPECT_TRUE(grid.sizeCheck(4, 3));
+  EXPECT_FALSE(grid.sizeCheck(4, 3));
+  for (unsigned int y = 0; y < 3; ++y) {
+    for (unsigned int x = 0; x < 4; ++x) {
+      EXPECT_EQ(grid.unreachableCellCosts(), grid.getCellCosts(x, y));
+    }
+  }
+  grid(1, 2) = 5;
+  EXPECT_EQ(5.0, grid.getCellCosts(1, 2));
+  EXPECT_EQ(5u, grid[2 * 4 + 1]);
+  grid.reset();
+  EXPECT_EQ(grid.unreachableCellCosts(), grid.getCellCosts(1, 2));
+  EXPECT_EQ(12.0, grid.obstacleCosts());
+  EXPECT_EQ(13.0, grid.unreachableCellCosts());
+}
+
+TEST(MapGridEngineTest, regionOfInterestInteriorExact) {
+  for (unsigned int seed = 1; seed <= 10; ++seed) {
+    costmap_2d::Costmap2D costmap(SIZE, SIZE, RESOLUTION, 0.0, 0.0);
+    fillCostmap(costmap, 0, 0, seed);
+    std::vector<geometry_msgs::PoseStamped> plan = makePlan(0.1, 4.9, 2.5, 1.0);
+    double roi_x = 1.0 + 0.2 * seed, roi_y = 2.5, roi_radius = 1.0;
+    MapGridEngine engine(&costmap);
+    engine.setRegionOfInterest(roi_x, roi_y, roi_radius);
+    engine.reset();
+    const CompactMapGrid* layers[] = {engine.getLayer(plan, false), engine.getLayer(plan, true)};
+
+    for (int k = 0; k < 2; ++k) {
+      MapGrid reference;
+      reference.sizeCheck(SIZE, SIZE);
+      reference.resetPathDist();
+      if (k == 1) {
+        reference.setLocalGoal(costmap, plan);
+      } else {
+        reference.setTargetCells(costmap, plan);
+      }
+      int center_x = int(floor(roi_x / RESOLUTION)), center_y = int(floor(roi_y / RESOLUTION));
+      int radius = int(floor(roi_radius / RESOLUTION));
+      unsigned int checked = 0;
+      for (int y = center_y - radius; y <= center_y + radius; ++y) {
+        for (int x = center_x - radius; x <= center_x + radius; ++x) {
+          double expected = reference(x, y).target_dist;
+          // a path shorter than the way to the edge of the region cannot leave it, so its length is exact
+          int to_edge = radius - std::max(abs(x - center_x), abs(y - center_y));
+          if (expected == reference.obstacleCosts() || expected < to_edge) {
+            EXPECT_EQ(expected, layers[k]->getCellCosts(x, y)) << "layer " << k << " cell " << x << ", " << y;
+            ++checked;
+          }
+        }
+      }
+      EXPECT_GT(checked, 0u);
+    }
+  }
+}
+
+} /* namespace base_local_planner */
@@ -0,0 +1,99 @@
+/*
+ * probability_cost_function_test.cpp
+ *
+ *      Author: Jeeseon Kim
+ */
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <vector>
+
+#include <base_local_planner/probability_cost_function.h>
+
+namespace base_local_planner {
+
+namespace {
+
+/**
+ * A robot at (1, 2) facing +y, with an obstacle from 0.7m on straight ahead
+ */
+PolarProbability makeObstacleAhead() {
+  PolarProbability polar;
+  polar.origin_x = 1.0;
+  polar.origin_y = 2.0;
+  polar.origin_yaw = M_PI / 2;
+  polar.range_resolution = 0.1;
+  polar.range_bins = 40;
+  polar.probability.assign(360 * 40, 0.0);
+  for (int b = 355; b < 365; ++b) {
+    for (int r = 7; r < 40; ++r) {
+      polar.probability[(b % 360) * 40 + r] = 0.6;
+    }
+  }
+  return polar;
+}
+
+/**
+ * A straight trajectory from the robot at 0.5m/s
+ */
+Trajectory makeStraight(double direction) {
+  Trajectory traj;
+  traj.time_delta_ = 0.1;
+  traj.thetav_ = 0.0;
+  for (int i = 0; i < 20; ++i) {
+    traj.addPoint(1.0 + 0.05 * i * cos(direction), 2.0 + 0.05 * i * sin(direction), M_PI / 2);
+  }
+  return traj;
+}
+
+}
+
+TEST(ProbabilityCostFunctionTest, polarCostsAreDiscountedProbabilities) {
+  ProbabilityCostFunction critic;
+  critic.setPolarProbability(makeObstacleAhead());
+  critic.setPolar(true, 0.8);
+
+  // reaches the obstacle 0.7m ahead after 1.4s
+  Trajectory ahead = makeStraight(M_PI / 2);
+  EXPECT_NEAR(0.6 * pow(0.8, 1.4), critic.scoreTrajectory(ahead), 1e-9);
+
+  // heading away from it, sideways or back
+  Trajectory sideways = makeStraight(0.0);
+  EXPECT_EQ(0.0, critic.scoreTrajectory(sideways));
+  Trajectory back = makeStraight(-M_PI / 2);
+  EXPECT_EQ(0.0, critic.scoreTrajectory(back));
+
+  // without a discount the probability is taken as is
+  critic.setPolar(true, 1.0);
+  EXPECT_NEAR(0.6, critic.scoreTrajectory(ahead), 1e-9);
+}
+
+TEST(ProbabilityCostFunctionTest, batchMatchesSingle) {
+  ProbabilityCostFunction critic;
+  critic.setPolarProbability(makeObstacleAhead());
+  std::vector<Trajectory> trajs;
+  std::vector<unsigned int> indices;
+  for (int k = 0; k < 16; ++k) {
+    trajs.push_back(makeStraight(k * M_PI / 8));
+    trajs.back().thetav_ = -1.0 + k * 0.125;
+    indices.push_back(15 - k);
+  }
+  std::vector<double> direction_probability(360);
+  for (unsigned int i = 0; i < direction_probability.size(); ++i) {
+    direction_probability[i] = i / 360.0;
+  }
+  critic.setDirectionProbability(direction_probability);
+
+  for (int polar = 0; polar < 2; ++polar) {
+    critic.setPolar(polar, 0.8);
+    std::vector<double> costs;
+    critic.scoreTrajectories(trajs, indices, costs);
+    ASSERT_EQ(indices.size(), costs.size());
+    for (unsigned int k = 0; k < indices.size(); ++k) {
+      EXPECT_EQ(critic.scoreTrajectory(trajs[indices[k]]), costs[k]) << "polar " << polar << " trajectory " << k;
+    }
+  }
+}
+
+} /* namespace base_local_planner */
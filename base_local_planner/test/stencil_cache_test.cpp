@@ -0,0 +1,175 @@
+/*
+ * stencil_cache_test.cpp
+ *
+ *      Author: Jeeseon Kim
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include <costmap_2d/cost_values.h>
+#include <base_local_planner/batch_obstacle_cost_function.h>
+
+namespace base_local_planner {
+
+namespace {
+
+const double RESOLUTION = 0.05;
+
+/**
+ * Scatter blobs of inflated cost, with a lethal center, over a costmap
+ */
+void scatterObstacles(costmap_2d::Costmap2D& costmap, unsigned int seed, int num_obstacles) {
+  srand(seed);
+  int size_x = costmap.getSizeInCellsX(), size_y = costmap.getSizeInCellsY();
+  for (int k = 0; k < num_obstacles; ++k) {
+    int x = rand() % size_x, y = rand() % size_y;
+    for (int dy = -4; dy <= 4; ++dy) {
+      for (int dx = -4; dx <= 4; ++dx) {
+        if (x + dx < 0 || y + dy < 0 || x + dx >= size_x || y + dy >= size_y) {
+          continue;
+        }
+        int d = abs(dx) + abs(dy);
+        unsigned char cost = d == 0 ? costmap_2d::LETHAL_OBSTACLE :
+            d < 2 ? costmap_2d::INSCRIBED_INFLATED_OBSTACLE : (unsigned char)std::max(0, 200 - d * 25);
+        if (cost > costmap.getCost(x + dx, y + dy)) {
+          costmap.setCost(x + dx, y + dy, cost);
+        }
+      }
+    }
+  }
+}
+
+/**
+ * Costs that change from cell to cell, so that any cell a stencil misses shows
+ */
+void scatterCosts(costmap_2d::Costmap2D& costmap, unsigned int seed) {
+  srand(seed);
+  for (unsigned int y = 0; y < costmap.getSizeInCellsY(); ++y) {
+    for (unsigned int x = 0; x < costmap.getSizeInCellsX(); ++x) {
+      int r = rand() % 1000;
+      if (r < 2) {
+        costmap.setCost(x, y, costmap_2d::LETHAL_OBSTACLE);
+      } else if (r < 100) {
+        costmap.setCost(x, y, (unsigned char)(1 + rand() % costmap_2d::INSCRIBED_INFLATED_OBSTACLE));
+      }
+    }
+  }
+}
+
+std::vector<geometry_msgs::Point> makeFootprint() {
+  std::vector<geometry_msgs::Point> footprint;
+  double corners[4][2] = {{0.2, 0.15}, {0.2, -0.15}, {-0.2, -0.15}, {-0.2, 0.15}};
+  for (int i = 0; i < 4; ++i) {
+    geometry_msgs::Point p;
+    p.x = corners[i][0];
+    p.y = corners[i][1];
+    footprint.push_back(p);
+  }
+  return footprint;
+}
+
+/**
+ * Arcs from a pose, for a range of translational and rotational velocities, as dwa rolls them out
+ */
+std::vector<Trajectory> makeArcs(double x, double y, double th) {
+  std::vector<Trajectory> trajs;
+  for (int a = 0; a < 6; ++a) {
+    for (int b = 0; b < 9; ++b) {
+      Trajectory traj;
+      traj.xv_ = 0.1 * a;
+      traj.yv_ = 0.0;
+      traj.thetav_ = -1.0 + 0.25 * b;
+      double px = x, py = y, pth = th;
+      for (int k = 0; k < 17; ++k) {
+        traj.addPoint(px, py, pth);
+        px += traj.xv_ * cos(pth) * 0.1;
+        py += traj.xv_ * sin(pth) * 0.1;
+        pth += traj.thetav_ * 0.1;
+      }
+      trajs.push_back(traj);
+    }
+  }
+  return trajs;
+}
+
+}
+
+TEST(BatchObstacleCostFunctionTest, stencilsNeverUndercutExactCosts) {
+  unsigned int num_trajs = 0, num_swept = 0;
+  for (unsigned int seed = 1; seed <= 10; ++seed) {
+    costmap_2d::Costmap2D costmap(120, 120, RESOLUTION, 0.0, 0.0);
+    scatterCosts(costmap, seed);
+    BatchObstacleCostFunction critic(&costmap);
+    critic.setFootprint(makeFootprint());
+    critic.setParams(0.55, 0.2, 0.25);
+    critic.prepare();
+
+    srand(seed);
+    for (int k = 0; k < 100; ++k) {
+      // anywhere in a cell and at any heading, so every stencil is used away from where it was rasterized
+      std::vector<Trajectory> trajs = makeArcs(1.5 + 3.0 * rand() / RAND_MAX, 1.5 + 3.0 * rand() / RAND_MAX,
+          2 * M_PI * rand() / RAND_MAX);
+      for (unsigned int i = 0; i < trajs.size(); ++i) {
+        critic.setStencilCache(false);
+        double exact = critic.scoreTrajectory(trajs[i]);
+        critic.setStencilCache(true);
+        double swept;
+        if (critic.sweptCost(trajs[i], swept)) {
+          // a stencil never lets a colliding trajectory through, nor makes one cheaper
+          EXPECT_GE(exact, 0.0) << "seed " << seed << " pose " << k << " trajectory " << i;
+          EXPECT_GE(swept, exact) << "seed " << seed << " pose " << k << " trajectory " << i;
+          ++num_swept;
+        }
+        // and scoring through the cache falls back to the exact check where the stencil cannot tell
+        double cost = critic.scoreTrajectory(trajs[i]);
+        EXPECT_EQ(exact < 0, cost < 0) << "seed " << seed << " pose " << k << " trajectory " << i;
+        ++num_trajs;
+      }
+    }
+  }
+  EXPECT_EQ(54000u, num_trajs);
+  EXPECT_GT(num_swept, num_trajs / 4);
+}
+
+TEST(BatchObstacleCostFunctionTest, stencilsAreReusedAcrossCycles) {
+  costmap_2d::Costmap2D costmap(200, 200, RESOLUTION, 0.0, 0.0);
+  scatterObstacles(costmap, 1, 20);
+  BatchObstacleCostFunction critic(&costmap);
+  critic.setFootprint(makeFootprint());
+  critic.setParams(0.55, 0.2, 0.25);
+  critic.setStencilCache(true);
+  critic.prepare();
+
+  // a robot driving a gentle curve at 0.3m/s, planning at 10Hz
+  double x = 2.0, y = 3.0, th = 0.3;
+  for (int cycle = 0; cycle < 100; ++cycle) {
+    std::vector<Trajectory> trajs = makeArcs(x, y, th);
+    for (unsigned int i = 0; i < trajs.size(); ++i) {
+      critic.scoreTrajectory(trajs[i]);
+    }
+    x += 0.03 * cos(th);
+    y += 0.03 * sin(th);
+    th += 0.02;
+  }
+  unsigned int hits, misses;
+  critic.getStencilStats(hits, misses);
+  EXPECT_EQ(100u * 54u, hits + misses);
+  // a new stencil per velocity only when the heading moves to another bin, about every fifth cycle here
+  EXPECT_GT(hits, 3 * misses);
+
+  // the parameters the stencils depend on start them over
+  critic.setParams(0.55, 0.3, 0.25);
+  std::vector<Trajectory> trajs = makeArcs(x, y, th);
+  critic.scoreTrajectory(trajs[0]);
+  unsigned int later_hits, later_misses;
+  critic.getStencilStats(later_hits, later_misses);
+  EXPECT_EQ(hits, later_hits);
+  EXPECT_EQ(misses + 1, later_misses);
+}
+
+} /* namespace base_local_planner */
@@ -55,17 +55,33 @@
 #include <base_local_planner/local_planner_limits.h>
 #include <base_local_planner/local_planner_util.h>
 #include <base_local_planner/simple_trajectory_generator.h>
+#include <base_local_planner/adaptive_trajectory_generator.h>
 
 #include <base_local_planner/oscillation_cost_function.h>
 #include <base_local_planner/map_grid_cost_function.h>
 #include <base_local_planner/obstacle_cost_function.h>
 #include <base_local_planner/twirling_cost_function.h>
-#include <base_local_planner/simple_scored_sampling_planner.h>
 #include <base_local_planner/probability_cost_function.h>
+#include <base_local_planner/batch_map_grid_cost_function.h>
+#include <base_local_planner/map_grid_engine.h>
+#include <base_local_planner/batch_obstacle_cost_function.h>
+#include <base_local_planner/costmap_snapshot.h>
+
+#include <dwa_local_planner2/scored_sampling_planner2.h>
+#include <dwa_local_planner2/fused_cost_function.h>
 
 #include <nav_msgs/Path.h>
 
 namespace dwa_local_planner2 {
+  /**
+   * @brief Safety probabilities of the scan directions, as computed from one scan
+   */
+  struct DirectionProbability {
+    ros::Time stamp; ///< @brief Stamp of the scan
+    std::vector<double> probability;
+    base_local_planner::PolarProbability polar; ///< @brief Collision probabilities by bearing and range, may be empty
+  };
+
   /**
    * @class DWAPlanner2
    * @brief A class implementing a local planner using the Dynamic Window Approach
@@ -135,6 +151,11 @@ namespace dwa_local_planner2 {
        */
       double getSimPeriod() { return sim_period_; }
 
+      /**
+       * @brief Get the fraction of the planned velocity samples the last findBestPath() scored before its deadline
+       */
+      double getCoverage() const { return coverage_; }
+
       /**
        * @brief Compute the components and total cost for a map grid cell
        * @param cx The x coordinate of the cell in the map grid
@@ -152,11 +173,31 @@ namespace dwa_local_planner2 {
        */
       bool setPlan(const std::vector<geometry_msgs::PoseStamped>& orig_global_plan);
 
+      /**
+       * @brief Pick the velocities of the best legal trajectories as seeds for refinement
+       * @param explored The scored trajectories, those pruned during the search have a negative cost and are skipped
+       * @param num_seeds The maximum number of seeds
+       * @param seeds Will be set to the velocities, lowest cost first
+       */
+      static void selectSeeds(const std::vector<base_local_planner::Trajectory>& explored,
+          unsigned int num_seeds, std::vector<Eigen::Vector3f>& seeds);
+
 	  //#!
       /**
        * @brief Set safety probability to each directions
+       *
+       * Safe to call from another thread, the next cycle picks up the latest
+       * probabilities without waiting for the caller.
+       * @param arr The probability of each scan direction
+       * @param stamp The stamp of the scan they were computed from
+       */
+      void setProbability(const std::vector<double> &arr, const ros::Time& stamp = ros::Time());
+
+      /**
+       * @brief Set safety probability to each directions and the polar collision probabilities
+       * @param safety_direction The probabilities, which must not be modified afterwards
        */
-      void setProbability(std::vector<double> &arr);
+      void setProbability(const boost::shared_ptr<const DirectionProbability>& safety_direction);
 	  //#!
 
     private:
@@ -167,11 +208,26 @@ namespace dwa_local_planner2 {
       double pdist_scale_, gdist_scale_, occdist_scale_;
       Eigen::Vector3f vsamples_;
 
+      bool adaptive_sampling_; ///< @brief Refine the best samples of the vsamples_ grid with local grids
+      int refine_candidates_, refine_samples_;
+      bool warm_start_; ///< @brief Search around the command of the last cycle before the vsamples_ grid
+      int warm_start_samples_;
+      double warm_start_grid_fraction_; ///< @brief Part of the vsamples_ grid searched after a legal warm start, 1 unless warm_start is set
+      double deadline_fraction_; ///< @brief Fraction of sim_period_ findBestPath may take, 0 for no limit
+      double coverage_;
+
       double sim_period_;///< @brief The number of seconds to use to compute max/min vels for dwa
       base_local_planner::Trajectory result_traj_;
 
       double forward_point_distance_;
 
+      bool roi_map_grids_; ///< @brief Propagate the shared map grids only where this cycle's trajectories can reach
+      double sim_time_;
+      double footprint_radius_;
+
+      bool costmap_snapshot_; ///< @brief Score obstacles against snapshot_ instead of the costmap
+      base_local_planner::CostmapSnapshot snapshot_;
+
       std::vector<geometry_msgs::PoseStamped> global_plan_;
 
       boost::mutex configuration_mutex_;
@@ -185,20 +241,28 @@ namespace dwa_local_planner2 {
       base_local_planner::MapGridVisualizer map_viz_; ///< @brief The map grid visualizer for outputting the potential field generated by the cost function
 
       // see constructor body for explanations
-      base_local_planner::SimpleTrajectoryGenerator generator_;
+      base_local_planner::AdaptiveTrajectoryGenerator generator_;
       base_local_planner::OscillationCostFunction oscillation_costs_;
-      base_local_planner::ObstacleCostFunction obstacle_costs_;
-      base_local_planner::MapGridCostFunction path_costs_;
-      base_local_planner::MapGridCostFunction goal_costs_;
-      base_local_planner::MapGridCostFunction goal_front_costs_;
-      base_local_planner::MapGridCostFunction alignment_costs_;
+      base_local_planner::BatchObstacleCostFunction obstacle_costs_;
+      base_local_planner::MapGridEngine map_grid_engine_; ///< @brief Grids shared by the map grid critics when enabled
+      base_local_planner::BatchMapGridCostFunction path_costs_;
+      base_local_planner::BatchMapGridCostFunction goal_costs_;
+      base_local_planner::BatchMapGridCostFunction goal_front_costs_;
+      base_local_planner::BatchMapGridCostFunction alignment_costs_;
       base_local_planner::TwirlingCostFunction twirling_costs_;
 	  //#!
       base_local_planner::ProbabilityCostFunction probability_costs_;
 	  //#!
-      base_local_planner::SimpleScoredSamplingPlanner scored_sampling_planner_;
 
-      std::vector<double> safety_direction_;
+      // obstacle, goal front, alignment, path and goal costs in a single pass over each trajectory
+      typedef FusedCostFunction<ObstacleTerm, MapGridTerm, MapGridTerm, MapGridTerm, MapGridTerm> GridCostFunction;
+      GridCostFunction grid_costs_;
+
+      std::vector<base_local_planner::TrajectoryCostFunction*> critics_; ///< @brief Every cost function scored on its own
+      std::vector<base_local_planner::TrajectoryCostFunction*> fused_critics_; ///< @brief Same critics with grid_costs_ in place of the grid based ones
+      ScoredSamplingPlanner2 scored_sampling_planner_;
+
+      boost::shared_ptr<const DirectionProbability> safety_direction_; ///< @brief Replaced as a whole, never modified
   };
 };
 #endif
@@ -59,6 +59,10 @@
 #include <base_local_planner/odometry_helper_ros.h>
 
 #include <dwa_local_planner2/dwa_planner2.h>
+#include <dwa_local_planner2/obstacle_tracker.h>
+#include <dwa_local_planner2/safety_kernel.h>
+#include <dwa_local_planner2/scan_slot.h>
+#include <dwa_local_planner2/scan_projector.h>
 
 //#!
 #include <nav_msgs/OccupancyGrid.h>
@@ -69,6 +73,9 @@
 #define MAP_INDEX(map, i, j) ((i) + (j) * map.size_x)
 #define MAP_WXGX(map, i) (map.origin_x + (i - map.size_x / 2) * map.scale)
 #define MAP_WYGY(map, j) (map.origin_y + (j - map.size_y / 2) * map.scale)
+#define MAP_GXWX(map, x) (floor((x - map.origin_x) / map.scale + map.size_x / 2 + 0.5))
+#define MAP_GYWY(map, y) (floor((y - map.origin_y) / map.scale + map.size_y / 2 + 0.5))
+#define MAP_VALID(map, i, j) ((i >= 0) && (i < map.size_x) && (j >= 0) && (j < map.size_y))
 
 // Information of the map
 struct map_inf {
@@ -160,10 +167,22 @@ namespace dwa_local_planner2 {
 
       //#!
       void scanCallBack(const sensor_msgs::LaserScan::ConstPtr& msg);
+      /**
+       * @brief Run computeTTC() on each new scan, when perception is asynchronous
+       */
+      void perceptionThread();
 	  /**
-	  * @brief Compute Time-to-Collision(TTC) when dynamic obstacles detected
+	  * @brief Compute Time-to-Collision(TTC) when dynamic obstacles detected, once per scan
 	  */
       void computeTTC();
+      /**
+       * @brief Set the number of directions computeTTC() gives safety probabilities for, and the kernel it spreads them with
+       */
+      void setDirectionBins(int direction_bins);
+      /**
+       * @brief Get the robot pose in the global frame at a time, or the latest pose if tf cannot tell
+       */
+      bool getPoseAt(const ros::Time& stamp, tf::Stamped<tf::Pose>& pose);
 	  /**
 	  * @brief Sense dynamic points and segment to each obstacle
 	  */
@@ -203,19 +222,32 @@ namespace dwa_local_planner2 {
 
       //#!
       nav_msgs::OccupancyGrid current_map_;
-      std::vector<std::pair<float, float> > map_position_;
+      map_inf map_info_;
+      std::vector<unsigned char> static_obs_grid_;   //1 if a cell lies within STATIC_OBS_DIST of an occupied map cell
       std::vector<int> obs_idx_;      //index data for valid ranges[] values
       tf::Stamped<tf::Pose> previous_pose_;
-
-      sensor_msgs::LaserScan rcv_msg_;
+      ros::Time previous_time_;
+
+      ScanSlot scan_slot_;    ///< @brief Latest scan, published by scanCallBack()
+      boost::mutex scan_mutex_;
+      boost::condition_variable scan_cond_;   //signalled by scanCallBack() for perceptionThread()
+      bool async_perception_;   ///< @brief Run computeTTC() in perception_thread_ rather than in computeVelocityCommands()
+      boost::thread* perception_thread_;
+      tf::Stamped<tf::Pose> perception_pose_;   //robot pose computeTTC() and findObstacles() work with
+      sensor_msgs::LaserScan::ConstPtr scan_;   //scan of the current computeTTC()
+      sensor_msgs::LaserScan::ConstPtr last_scan_;   //scan last taken from scan_slot_
+      ScanProjector projector_;   //beams of scan_ in the world frame
       sensor_msgs::LaserScan lsr_msg_;
       ros::Subscriber scan_sub;
 
       std::vector<std::pair<float, float> > curr_obs_;
+      ObstacleTracker tracker_;   ///< @brief Associates curr_obs_ across scans
 
       std::vector<int> obs_direction_;
       std::vector<float> obs_safe_prob_;
       std::vector<double> robot_safe_dir_;
+      int direction_bins_;    ///< @brief Size of robot_safe_dir_, the directions are bins of equal angle
+      SafetyKernel safety_kernel_;   //spreads obs_safe_prob_ over the directions
 
       base_local_planner::ProbabilityCostFunction prob_cost_function_;
       //#!
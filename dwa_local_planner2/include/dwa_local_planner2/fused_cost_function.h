@@ -0,0 +1,408 @@
+/*********************************************************************
+ *
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2017, Open Source Robotics Foundation, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Author: Jeeseon Kim
+ *********************************************************************/
+
+#ifndef DWA_LOCAL_PLANNER2_FUSED_COST_FUNCTION_H_
+#define DWA_LOCAL_PLANNER2_FUSED_COST_FUNCTION_H_
+
+#include <algorithm>
+#include <cmath>
+#include <tuple>
+#include <type_traits>
+
+#include <ros/console.h>
+
+#include <costmap_2d/costmap_2d.h>
+#include <base_local_planner/trajectory_cost_function.h>
+#include <base_local_planner/bounded_cost_function.h>
+#include <base_local_planner/batch_map_grid_cost_function.h>
+#include <base_local_planner/batch_obstacle_cost_function.h>
+
+namespace dwa_local_planner2 {
+  /**
+   * @brief A trajectory point visited by the terms of a FusedCostFunction,
+   * with the map cells of the point computed at most once
+   */
+  class FusedPoint {
+    public:
+      FusedPoint(const costmap_2d::Costmap2D* costmap) :
+          origin_x_(costmap->getOriginX()),
+          origin_y_(costmap->getOriginY()),
+          resolution_(costmap->getResolution()),
+          size_x_(costmap->getSizeInCellsX()),
+          size_y_(costmap->getSizeInCellsY()) {}
+
+      void set(double x, double y, double th) {
+        x_ = x;
+        y_ = y;
+        th_ = th;
+        center_state_ = UNKNOWN;
+        shifted_state_ = UNKNOWN;
+      }
+
+      double x() const { return x_; }
+      double y() const { return y_; }
+      double th() const { return th_; }
+
+      /**
+       * @brief Map cell of the point itself, false if it is off the map
+       */
+      bool centerCell(unsigned int& cx, unsigned int& cy) {
+        if (center_state_ == UNKNOWN) {
+          center_state_ = toMap(x_, y_, center_x_, center_y_) ? VALID : OFF_MAP;
+        }
+        cx = center_x_;
+        cy = center_y_;
+        return center_state_ == VALID;
+      }
+
+      /**
+       * @brief Map cell of the point shifted in the robot frame, shared by all terms using the same shift
+       */
+      bool shiftedCell(double xshift, double yshift, double& px, double& py, unsigned int& cx, unsigned int& cy) {
+        if (xshift == 0.0 && yshift == 0.0) {
+          px = x_;
+          py = y_;
+          return centerCell(cx, cy);
+        }
+        if (shifted_state_ == UNKNOWN || xshift != xshift_ || yshift != yshift_) {
+          xshift_ = xshift;
+          yshift_ = yshift;
+          shifted_px_ = x_;
+          shifted_py_ = y_;
+          if (xshift != 0.0) {
+            shifted_px_ = shifted_px_ + xshift * cos(th_);
+            shifted_py_ = shifted_py_ + xshift * sin(th_);
+          }
+          if (yshift != 0.0) {
+            shifted_px_ = shifted_px_ + yshift * cos(th_ + M_PI_2);
+            shifted_py_ = shifted_py_ + yshift * sin(th_ + M_PI_2);
+          }
+          shifted_state_ = toMap(shifted_px_, shifted_py_, shifted_x_, shifted_y_) ? VALID : OFF_MAP;
+        }
+        px = shifted_px_;
+        py = shifted_py_;
+        cx = shifted_x_;
+        cy = shifted_y_;
+        return shifted_state_ == VALID;
+      }
+
+    private:
+      enum CellState { UNKNOWN, VALID, OFF_MAP };
+
+      // same checks as Costmap2D::worldToMap()
+      bool toMap(double wx, double wy, unsigned int& mx, unsigned int& my) const {
+        if (wx < origin_x_ || wy < origin_y_) {
+          return false;
+        }
+        mx = (int)((wx - origin_x_) / resolution_);
+        my = (int)((wy - origin_y_) / resolution_);
+        return mx < size_x_ && my < size_y_;
+      }
+
+      double origin_x_, origin_y_, resolution_;
+      unsigned int size_x_, size_y_;
+
+      double x_, y_, th_;
+      CellState center_state_, shifted_state_;
+      unsigned int center_x_, center_y_;
+      double xshift_, yshift_;
+      double shifted_px_, shifted_py_;
+      unsigned int shifted_x_, shifted_y_;
+  };
+
+  /**
+   * @brief Fused term for a BatchMapGridCostFunction, same costs as its scoreTrajectory()
+   */
+  class MapGridTerm {
+    public:
+      typedef base_local_planner::BatchMapGridCostFunction Critic;
+
+      MapGridTerm(Critic* critic) : critic_(critic) {}
+
+      base_local_planner::TrajectoryCostFunction* critic() const { return critic_; }
+
+      double begin(base_local_planner::Trajectory&) {
+        aggregation_ = critic_->getAggregationType();
+        cost_ = aggregation_ == base_local_planner::Product ? 1.0 : 0.0;
+        return 0.0;
+      }
+
+      double visit(FusedPoint& pt) {
+        double px, py;
+        unsigned int cell_x, cell_y;
+        if ( ! pt.shiftedCell(critic_->getXShift(), critic_->getYShift(), px, py, cell_x, cell_y)) {
+          ROS_WARN("Off Map %f, %f", px, py);
+          return -4.0;
+        }
+        double grid_dist = critic_->getCellCosts(cell_x, cell_y);
+        if (critic_->getStopOnFailure()) {
+          if (grid_dist == critic_->obstacleCosts()) {
+            return -3.0;
+          } else if (grid_dist == critic_->unreachableCellCosts()) {
+            return -2.0;
+          }
+        }
+        switch (aggregation_) {
+        case base_local_planner::Last:
+          cost_ = grid_dist;
+          break;
+        case base_local_planner::Sum:
+          cost_ += grid_dist;
+          break;
+        case base_local_planner::Product:
+          if (cost_ > 0) {
+            cost_ *= grid_dist;
+          }
+          break;
+        }
+        return 0.0;
+      }
+
+      double cost() const { return cost_; }
+
+      double bound(base_local_planner::Trajectory& traj) const { return critic_->costLowerBound(traj); }
+
+    private:
+      Critic* critic_;
+      base_local_planner::CostAggregationType aggregation_;
+      double cost_;
+  };
+
+  /**
+   * @brief Fused term for a BatchObstacleCostFunction, same costs as its scoreTrajectory()
+   *
+   * With a swept footprint stencil the cost is known up front, trajectories that may fail are
+   * visited pose by pose.
+   */
+  class ObstacleTerm {
+    public:
+      typedef base_local_planner::BatchObstacleCostFunction Critic;
+
+      ObstacleTerm(Critic* critic) : critic_(critic) {}
+
+      base_local_planner::TrajectoryCostFunction* critic() const { return critic_; }
+
+      double begin(base_local_planner::Trajectory& traj) {
+        cost_ = 0.0;
+        sum_scores_ = critic_->getSumScores();
+        if ( ! critic_->hasFootprint()) {
+          ROS_ERROR("Footprint spec is empty, maybe missing call to setFootprint?");
+          return -9.0;
+        }
+        swept_ = critic_->sweptCost(traj, cost_);
+        return 0.0;
+      }
+
+      double visit(FusedPoint& pt) {
+        if (swept_) {
+          return 0.0;
+        }
+        unsigned int cell_x, cell_y;
+        if ( ! pt.centerCell(cell_x, cell_y)) {
+          // the footprint check fails first for poses off the map
+          return -6.0;
+        }
+        if (critic_->poseAtMost(cell_x, cell_y, sum_scores_ ? 0.0 : cost_)) {
+          // neither fails nor adds to the cost
+          return 0.0;
+        }
+        double f_cost = critic_->poseCost(pt.x(), pt.y(), pt.th(), cell_x, cell_y);
+        if (f_cost < 0) {
+          return f_cost;
+        }
+        if (sum_scores_) {
+          cost_ += f_cost;
+        } else {
+          cost_ = std::max(cost_, f_cost);
+        }
+        return 0.0;
+      }
+
+      double cost() const { return cost_; }
+
+      double bound(base_local_planner::Trajectory& traj) const { return critic_->costLowerBound(traj); }
+
+    private:
+      Critic* critic_;
+      bool sum_scores_;
+      double cost_;
+      bool swept_;
+  };
+
+  /**
+   * @class FusedCostFunction
+   * @brief Scores a trajectory with a compile-time list of grid based critics in a single pass
+   *
+   * Each trajectory point is converted to map cells once and handed to every term in
+   * turn, instead of every critic walking the trajectory on its own. Once a term fails only
+   * the terms before it are still visited, so the returned failure code is the one of the
+   * first failing critic in order. Otherwise the returned cost is the sum of the scaled term
+   * costs, accumulated in the order of the terms, so it equals the sum the critics would add
+   * up one after another. The critic wrapping the terms must keep a scale of 1.0.
+   * Its lower bound is the sum of the scaled bounds of the terms.
+   */
+  template <typename... Terms>
+  class FusedCostFunction : public base_local_planner::TrajectoryCostFunction, public base_local_planner::BoundedCostFunction {
+    public:
+      FusedCostFunction(costmap_2d::Costmap2D* costmap, Terms... terms) :
+          costmap_(costmap),
+          point_(costmap),
+          terms_(terms...) {}
+
+      bool prepare() {
+        // the map geometry the terms are prepared for
+        point_ = FusedPoint(costmap_);
+        return prepareTerms<0>();
+      }
+
+      double scoreTrajectory(base_local_planner::Trajectory& traj) {
+        // terms accumulate per trajectory, work on a copy so trajectories can be scored concurrently
+        std::tuple<Terms...> terms(terms_);
+        bool active[sizeof...(Terms)];
+        double cost = beginTerms<0>(terms, traj, active);
+        if (cost < 0) {
+          return cost;
+        }
+
+        FusedPoint pt(point_);
+        double px, py, pth;
+        // terms from live on are decided, the failure of the first of them is the result
+        std::size_t live = sizeof...(Terms);
+        double failure = 0.0;
+        for (unsigned int i = 0; i < traj.getPointsSize() && live > 0; ++i) {
+          traj.getPoint(i, px, py, pth);
+          pt.set(px, py, pth);
+          visitTerms<0>(terms, pt, active, live, failure);
+        }
+        if (failure < 0) {
+          return failure;
+        }
+        return sumTerms<0>(terms, active, 0.0);
+      }
+
+      double costLowerBound(base_local_planner::Trajectory& traj) {
+        return boundTerms<0>(traj, 0.0);
+      }
+
+    private:
+      template <std::size_t I>
+      typename std::enable_if<I == sizeof...(Terms), bool>::type prepareTerms() { return true; }
+
+      template <std::size_t I>
+      typename std::enable_if<I < sizeof...(Terms), bool>::type prepareTerms() {
+        if (std::get<I>(terms_).critic()->prepare() == false) {
+          return false;
+        }
+        return prepareTerms<I + 1>();
+      }
+
+      template <std::size_t I>
+      typename std::enable_if<I == sizeof...(Terms), double>::type beginTerms(std::tuple<Terms...>&, base_local_planner::Trajectory&, bool*) {
+        return 0.0;
+      }
+
+      template <std::size_t I>
+      typename std::enable_if<I < sizeof...(Terms), double>::type beginTerms(std::tuple<Terms...>& terms, base_local_planner::Trajectory& traj, bool* active) {
+        // critics without weight are skipped, as in the scoring loop
+        active[I] = std::get<I>(terms).critic()->getScale() != 0;
+        if (active[I]) {
+          double cost = std::get<I>(terms).begin(traj);
+          if (cost < 0) {
+            return cost;
+          }
+        }
+        return beginTerms<I + 1>(terms, traj, active);
+      }
+
+      template <std::size_t I>
+      typename std::enable_if<I == sizeof...(Terms), void>::type visitTerms(std::tuple<Terms...>&, FusedPoint&, const bool*,
+          std::size_t&, double&) {}
+
+      template <std::size_t I>
+      typename std::enable_if<I < sizeof...(Terms), void>::type visitTerms(std::tuple<Terms...>& terms, FusedPoint& pt, const bool* active,
+          std::size_t& live, double& failure) {
+        if (I >= live) {
+          return;
+        }
+        if (active[I]) {
+          double cost = std::get<I>(terms).visit(pt);
+          if (cost < 0) {
+            live = I;
+            failure = cost;
+            return;
+          }
+        }
+        visitTerms<I + 1>(terms, pt, active, live, failure);
+      }
+
+      template <std::size_t I>
+      typename std::enable_if<I == sizeof...(Terms), double>::type sumTerms(std::tuple<Terms...>&, const bool*, double total) {
+        return total;
+      }
+
+      template <std::size_t I>
+      typename std::enable_if<I < sizeof...(Terms), double>::type sumTerms(std::tuple<Terms...>& terms, const bool* active, double total) {
+        if (active[I]) {
+          double cost = std::get<I>(terms).cost();
+          if (cost != 0) {
+            cost *= std::get<I>(terms).critic()->getScale();
+          }
+          total += cost;
+        }
+        return sumTerms<I + 1>(terms, active, total);
+      }
+
+      template <std::size_t I>
+      typename std::enable_if<I == sizeof...(Terms), double>::type boundTerms(base_local_planner::Trajectory&, double total) {
+        return total;
+      }
+
+      template <std::size_t I>
+      typename std::enable_if<I < sizeof...(Terms), double>::type boundTerms(base_local_planner::Trajectory& traj, double total) {
+        double scale = std::get<I>(terms_).critic()->getScale();
+        if (scale != 0) {
+          total += std::get<I>(terms_).bound(traj) * scale;
+        }
+        return boundTerms<I + 1>(traj, total);
+      }
+
+      costmap_2d::Costmap2D* costmap_;
+      FusedPoint point_;
+      std::tuple<Terms...> terms_;
+  };
+};
+#endif
@@ -0,0 +1,98 @@
+/*********************************************************************
+ *
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2017, Open Source Robotics Foundation, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Author: Jeeseon Kim
+ *********************************************************************/
+
+#ifndef DWA_LOCAL_PLANNER2_OBSTACLE_TRACKER_H_
+#define DWA_LOCAL_PLANNER2_OBSTACLE_TRACKER_H_
+
+#include <vector>
+#include <utility>
+
+namespace dwa_local_planner2 {
+  /**
+   * @class ObstacleTracker
+   * @brief Associates dynamic obstacles between scans and keeps a constant
+   * velocity estimate for each of them
+   *
+   * Association uses a spatial hash with cells of the gating distance, so an
+   * update costs O(n log n) in the number of detections and tracks.
+   */
+  class ObstacleTracker {
+    public:
+      struct Track {
+        unsigned int id;
+        float x, y;           ///< @brief Position in the world frame (predicted while unobserved)
+        float vx, vy;         ///< @brief Velocity in the world frame, m/s
+        unsigned int age;     ///< @brief Number of updates the track has been observed in
+        unsigned int missed;  ///< @brief Consecutive updates without an associated detection
+      };
+
+      /**
+       * @brief  Constructor for the tracker
+       * @param gate_dist Maximum distance between a predicted track and a detection to associate them, at least 0.01
+       * @param max_missed Number of consecutive updates a track survives without detections
+       */
+      ObstacleTracker(double gate_dist = 0.5, unsigned int max_missed = 2);
+
+      /**
+       * @brief Set the parameters of the constructor, a gate_dist below 0.01 is raised to it
+       */
+      void setParameters(double gate_dist, unsigned int max_missed);
+
+      /**
+       * @brief Predict all tracks forward, associate them with the new detections and update their state
+       * @param detections Obstacle centres in the world frame
+       * @param dt Time since the previous update in seconds
+       * @param assoc Will be set to the index in getTracks() of the track of each detection
+       */
+      void update(const std::vector<std::pair<float, float> >& detections, double dt, std::vector<int>& assoc);
+
+      const std::vector<Track>& getTracks() const { return tracks_; }
+
+      /**
+       * @brief Drop all tracks
+       */
+      void clear();
+
+    private:
+      std::vector<Track> tracks_;
+      unsigned int next_id_;
+
+      double gate_dist_;
+      unsigned int max_missed_;
+  };
+};
+#endif
@@ -0,0 +1,105 @@
+/*********************************************************************
+ *
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2017, Open Source Robotics Foundation, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Author: Jeeseon Kim
+ *********************************************************************/
+
+
+#ifndef DWA_LOCAL_PLANNER2_SAFETY_KERNEL_H_
+#define DWA_LOCAL_PLANNER2_SAFETY_KERNEL_H_
+
+#include <cstddef>
+#include <vector>
+
+namespace dwa_local_planner2 {
+  /**
+   * @class SafetyKernel
+   * @brief Spreads the collision probability of an obstacle over the direction bins around it
+   *
+   * The weight of a bin is a gaussian of the angle in degrees between the bin
+   * and the obstacle, exp(-(alpha * angle)^2 / (2 * sigma)), over the circular
+   * offset of the bins. It is cut off where it drops below epsilon, and to at
+   * most half a turn on either side, so an obstacle only touches the bins near it.
+   */
+  class SafetyKernel {
+    public:
+      SafetyKernel() : direction_bins_(1), radius_(0) {}
+
+      /**
+       * @brief Compute the weights for the bins of a full turn
+       * @param direction_bins The number of bins of equal angle
+       * @param alpha Scale of the angle in degrees
+       * @param sigma Variance of the gaussian
+       * @param epsilon Weights below this are left out
+       */
+      void build(int direction_bins, double alpha, double sigma, double epsilon);
+
+      int getDirectionBins() const { return direction_bins_; }
+
+      /**
+       * @brief Spread an obstacle over the bins around its own
+       * @param bin The bin of the obstacle
+       * @param weight The collision probability of the obstacle
+       * @param safety Safety probability of each bin, lowered to 1 - weight * kernel
+       * @param probability NULL, or range_bins collision probabilities of each bin,
+       * raised to weight * kernel from range_start on
+       * @param range_bins The number of range bins of probability
+       * @param range_start The first range bin the obstacle may be hit at
+       */
+      void spread(int bin, double weight, double* safety,
+          double* probability = NULL, int range_bins = 0, int range_start = 0) const;
+
+    private:
+      int direction_bins_;
+      std::vector<double> kernel_;   //weights of bin offsets -radius_ to radius_
+      int radius_;
+  };
+
+  /**
+   * @brief safety[i] = min(safety[i], 1 - kernel[i] * weight), two bins at a
+   * time where SSE2 is available. A NaN 1 - kernel[i] * weight leaves safety[i] as is.
+   */
+  void lowerSafety(double* safety, const double* kernel, int n, double weight);
+
+  /**
+   * @brief Same as lowerSafety() without SSE2
+   */
+  void lowerSafetyScalar(double* safety, const double* kernel, int n, double weight);
+
+  /**
+   * @brief probability[i] = max(probability[i], value)
+   */
+  void raiseProbability(double* probability, int n, double value);
+};
+#endif
@@ -0,0 +1,91 @@
+/*********************************************************************
+ *
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2017, Open Source Robotics Foundation, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Author: Jeeseon Kim
+ *********************************************************************/
+
+#ifndef DWA_LOCAL_PLANNER2_SCAN_PROJECTOR_H_
+#define DWA_LOCAL_PLANNER2_SCAN_PROJECTOR_H_
+
+#include <vector>
+
+#include <sensor_msgs/LaserScan.h>
+
+namespace dwa_local_planner2 {
+  /**
+   * @class ScanProjector
+   * @brief Projects the beams of laser scans to points in the world frame
+   *
+   * The directions of the beams relative to the scanner are kept as unit
+   * vectors and only recomputed when angle_min, angle_increment or the number
+   * of beams change, so a projection rotates them once by the robot yaw and
+   * scales them by the ranges, four beams at a time where SSE2 is available.
+   * Beams outside [range_min, range_max), including NaN ones, are marked
+   * invalid rather than skipped.
+   */
+  class ScanProjector {
+    public:
+      ScanProjector() : angle_min_(0.0), angle_increment_(0.0) {}
+
+      /**
+       * @brief Project all beams of a scan taken at a robot pose
+       * @param scan The scan
+       * @param x The x coordinate of the robot in the world frame
+       * @param y The y coordinate of the robot in the world frame
+       * @param yaw The yaw of the robot in the world frame
+       */
+      void project(const sensor_msgs::LaserScan& scan, float x, float y, float yaw);
+
+      /**
+       * @brief Coordinates of the points of the last projection, by beam
+       */
+      const std::vector<float>& getX() const { return x_; }
+      const std::vector<float>& getY() const { return y_; }
+
+      /**
+       * @brief Whether the range of each beam of the last projection was valid
+       */
+      bool isValid(unsigned int i) const { return valid_[i] != 0; }
+
+    private:
+      void updateDirections(const sensor_msgs::LaserScan& scan);
+
+      float angle_min_, angle_increment_;
+      std::vector<float> cos_, sin_;
+
+      std::vector<float> x_, y_;
+      std::vector<unsigned char> valid_;
+  };
+};
+#endif
@@ -0,0 +1,99 @@
+/*********************************************************************
+ *
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2017, Open Source Robotics Foundation, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Author: Jeeseon Kim
+ *********************************************************************/
+#ifndef DWA_LOCAL_PLANNER2_SCAN_SLOT_H_
+#define DWA_LOCAL_PLANNER2_SCAN_SLOT_H_
+
+#include <boost/atomic.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <sensor_msgs/LaserScan.h>
+
+namespace dwa_local_planner2 {
+  /**
+   * @class ScanSlot
+   * @brief Hands the latest laser scan from the subscriber callback to the controller thread
+   *
+   * The callback publishes the message it received without copying it, and
+   * readers take a reference to the scan published last. Published scans are
+   * never modified, so a reader has a complete scan for as long as it holds
+   * it, however many scans arrive meanwhile. The version counts the scans
+   * published.
+   */
+  class ScanSlot {
+    public:
+      /**
+       * @brief  Constructor for the slot, which holds an empty scan of version 0
+       */
+      ScanSlot() : scan_(new sensor_msgs::LaserScan()), version_(0) {}
+
+      /**
+       * @brief Publish a scan, which must not be modified afterwards
+       */
+      void publish(const sensor_msgs::LaserScan::ConstPtr& scan) {
+        boost::atomic_store(&scan_, scan);
+        version_.fetch_add(1, boost::memory_order_release);
+      }
+
+      /**
+       * @brief The number of scans published
+       */
+      unsigned int getVersion() const {
+        return version_.load(boost::memory_order_acquire);
+      }
+
+      /**
+       * @brief The scan published last
+       */
+      sensor_msgs::LaserScan::ConstPtr load() const {
+        return boost::atomic_load(&scan_);
+      }
+
+      /**
+       * @brief The scan published last and its version
+       * @param version Will be set to the version, the scan is at least that recent
+       */
+      sensor_msgs::LaserScan::ConstPtr load(unsigned int& version) const {
+        version = version_.load(boost::memory_order_acquire);
+        return boost::atomic_load(&scan_);
+      }
+
+    private:
+      sensor_msgs::LaserScan::ConstPtr scan_;
+      boost::atomic<unsigned int> version_;
+  };
+};
+#endif
@@ -0,0 +1,245 @@
+/*********************************************************************
+ *
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2017, Open Source Robotics Foundation, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Author: Jeeseon Kim
+ *********************************************************************/
+
+#ifndef DWA_LOCAL_PLANNER2_SCORED_SAMPLING_PLANNER2_H_
+#define DWA_LOCAL_PLANNER2_SCORED_SAMPLING_PLANNER2_H_
+
+#include <vector>
+
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+
+#include <ros/ros.h>
+
+#include <base_local_planner/trajectory.h>
+#include <base_local_planner/trajectory_cost_function.h>
+#include <base_local_planner/trajectory_sample_generator.h>
+#include <base_local_planner/trajectory_search.h>
+#include <base_local_planner/batch_cost_function.h>
+#include <base_local_planner/bounded_cost_function.h>
+
+namespace dwa_local_planner2 {
+  /**
+   * @class ScoringThreadPool
+   * @brief A fixed set of worker threads that stay alive between control cycles
+   */
+  class ScoringThreadPool {
+    public:
+      /**
+       * @param num_workers Number of threads started in addition to the calling thread
+       */
+      ScoringThreadPool(unsigned int num_workers);
+      ~ScoringThreadPool();
+
+      /**
+       * @brief Number of threads executing tasks, including the caller of run()
+       */
+      unsigned int size() const { return num_workers_ + 1; }
+
+      /**
+       * @brief Execute task(0) ... task(num_tasks - 1) on the pool and the calling thread, returns once all are done
+       */
+      void run(const boost::function<void (unsigned int)>& task, unsigned int num_tasks);
+
+    private:
+      void workerLoop();
+
+      unsigned int num_workers_;
+      boost::thread_group workers_;
+      boost::mutex mutex_;
+      boost::condition_variable work_cond_, done_cond_;
+
+      boost::function<void (unsigned int)> task_;
+      unsigned int num_tasks_, next_task_, pending_;
+      bool shutdown_;
+  };
+
+  /**
+   * @class ScoredSamplingPlanner2
+   * @brief Generates trajectories from a list of generators and scores them with a list of critics,
+   * like base_local_planner::SimpleScoredSamplingPlanner, optionally using several threads for scoring
+   *
+   * In parallel mode all samples are generated first and dealt out to the threads in turn, in blocks
+   * of samples in batch mode. Each share is scored like the serial loop and the best
+   * trajectory is reduced in sample order, so the result does not depend on the number of threads.
+   * Critics are prepared before scoring starts and their scoreTrajectory() must not modify shared
+   * state; stateful critics such as OscillationCostFunction are only updated after the search.
+   *
+   * In batch mode each critic scores all trajectories of a block that are still legal in one call,
+   * through base_local_planner::BatchCostFunction where the critic implements it and through
+   * an adapter otherwise. Batches are not pruned against the best cost, which only changes the
+   * reported costs of trajectories that cannot win.
+   *
+   * With bound pruning, critics implementing base_local_planner::BoundedCostFunction give a lower
+   * bound of their cost before scoring starts. A trajectory is abandoned as soon as its running cost
+   * plus the bounds of the critics still to run exceeds the best cost, so the chosen trajectory is
+   * the same as without pruning. Trajectories abandoned against the best cost, with or without
+   * bound pruning, get the cost -8 instead of their partial cost.
+   *
+   * With a deadline, searches stop taking and scoring samples once it has passed and return the best
+   * trajectory among the samples scored so far, so samples should come in order of priority.
+   * Blocks of the batch mode are scored entirely or not at all.
+   */
+  class ScoredSamplingPlanner2 : public base_local_planner::TrajectorySearch {
+    public:
+      ScoredSamplingPlanner2() : max_samples_(-1), batch_scoring_(false), bound_pruning_(false),
+          num_covered_(0), timed_out_(false), initial_best_cost_(-1) {}
+      ~ScoredSamplingPlanner2() {}
+
+      /**
+       * @brief Constructor for the planner
+       * @param gen_list List of generators, tried in order until one yields a valid trajectory
+       * @param critics List of critics, applied in order; a negative cost aborts scoring
+       * @param max_samples Maximum number of samples taken from each generator, -1 for no limit
+       */
+      ScoredSamplingPlanner2(std::vector<base_local_planner::TrajectorySampleGenerator*> gen_list,
+          std::vector<base_local_planner::TrajectoryCostFunction*>& critics,
+          int max_samples = -1);
+
+      /**
+       * @brief Replace the list of critics, applied in order
+       */
+      void setCritics(std::vector<base_local_planner::TrajectoryCostFunction*>& critics);
+
+      /**
+       * @brief Set the number of threads used for scoring, 1 disables parallel scoring
+       */
+      void setThreads(unsigned int num_threads);
+
+      /**
+       * @brief Score each critic over a whole block of trajectories at once
+       */
+      void setBatchScoring(bool batch_scoring) { batch_scoring_ = batch_scoring; }
+
+      /**
+       * @brief Abandon trajectories whose cost lower bound already exceeds the best cost
+       */
+      void setBoundPruning(bool bound_pruning) { bound_pruning_ = bound_pruning; }
+
+      /**
+       * @brief Set the wall time at which searches stop, a zero time for no deadline
+       */
+      void setDeadline(const ros::WallTime& deadline) { deadline_ = deadline; }
+
+      /**
+       * @brief Number of samples taken from the generators and fully handled by the last search
+       */
+      unsigned int getNumCovered() const { return num_covered_; }
+
+      /**
+       * @brief Whether the last search was cut off by the deadline
+       */
+      bool timedOut() const { return timed_out_; }
+
+      /**
+       * @brief Score a single trajectory with all critics
+       * @param best_traj_cost Cost of the best trajectory so far, scoring stops once it is exceeded (-1 for none)
+       * @return The cost of the trajectory, negative if a critic rejected it or -8 if scoring stopped
+       */
+      double scoreTrajectory(base_local_planner::Trajectory& traj, double best_traj_cost);
+
+      /**
+       * @brief Calls generators and critics to find the trajectory with the lowest cost
+       * @param traj Will be set to the best trajectory found
+       * @param all_explored Optionally filled with all trajectories evaluated, in sample order
+       * @return True if a legal trajectory was found
+       */
+      bool findBestTrajectory(base_local_planner::Trajectory& traj, std::vector<base_local_planner::Trajectory>* all_explored = 0);
+
+      /**
+       * @brief Prepare all critics for a new search, the first half of findBestTrajectory()
+       * @return False if a critic failed to prepare
+       */
+      bool prepareCritics();
+
+      /**
+       * @brief Search the samples of the generators with critics that are already prepared,
+       * the second half of findBestTrajectory(). May be called several times per preparation.
+       * @param best_cost Cost of a trajectory found before, -1 for none. It bounds pruning from the
+       * start, and only a trajectory that is strictly better is returned.
+       * @return True if a legal trajectory better than best_cost was found
+       */
+      bool searchBestTrajectory(base_local_planner::Trajectory& traj, std::vector<base_local_planner::Trajectory>* all_explored = 0,
+          double best_cost = -1);
+
+    private:
+      /**
+       * @brief Score a single trajectory, adding the number of critics called to evaluations
+       */
+      double scoreTrajectory(base_local_planner::Trajectory& traj, double best_traj_cost, unsigned int& evaluations);
+
+      bool deadlineExpired() const { return !deadline_.isZero() && ros::WallTime::now() >= deadline_; }
+
+      /**
+       * @brief Score every stride-th sample of samples_[begin, end) in order, pruning against the best cost among them
+       * @return The number of critic evaluations
+       */
+      unsigned int scoreRange(unsigned int begin, unsigned int end, unsigned int stride);
+
+      /**
+       * @brief Score samples_[begin, end) critic by critic through the batch interface
+       * @return The number of critic evaluations
+       */
+      unsigned int scoreRangeBatch(unsigned int begin, unsigned int end);
+
+      void scoreChunk(unsigned int chunk, unsigned int num_chunks);
+
+      std::vector<base_local_planner::TrajectorySampleGenerator*> gen_list_;
+      std::vector<base_local_planner::TrajectoryCostFunction*> critics_;
+      int max_samples_;
+
+      bool batch_scoring_;
+      std::vector<base_local_planner::BatchCostFunction*> batch_critics_;
+      std::vector<boost::shared_ptr<base_local_planner::BatchCostFunctionAdapter> > adapters_;
+
+      bool bound_pruning_;
+      std::vector<base_local_planner::BoundedCostFunction*> bounded_critics_;
+
+      ros::WallTime deadline_;
+      unsigned int num_covered_;
+      bool timed_out_;
+
+      boost::shared_ptr<ScoringThreadPool> pool_;
+      std::vector<base_local_planner::Trajectory> samples_;
+      std::vector<double> sample_costs_;
+      std::vector<unsigned char> sample_scored_;
+      std::vector<unsigned int> chunk_evaluations_;
+      double initial_best_cost_;
+  };
+};
+#endif
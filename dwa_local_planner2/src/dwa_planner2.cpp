@@ -39,11 +39,13 @@
 #include <base_local_planner/goal_functions.h>
 #include <base_local_planner/map_grid_cost_point.h>
 #include <cmath>
+#include <algorithm>
 
 //for computing path distance
 #include <queue>
 
 #include <angles/angles.h>
+#include <costmap_2d/footprint.h>
 
 #include <ros/ros.h>
 
@@ -62,6 +64,8 @@ namespace dwa_local_planner2 {
         config.angular_sim_granularity,
         config.use_dwa,
         sim_period_);
+    // rollouts are only velocity dependent with dwa, the generator ignores the cache otherwise
+    generator_.setRolloutCache(config.rollout_cache_resolution);
 
     double resolution = planner_util_->getCostmap()->getResolution();
     pdist_scale_ = config.path_distance_bias;
@@ -84,10 +88,28 @@ namespace dwa_local_planner2 {
  
     // obstacle costs can vary due to scaling footprint feature
     obstacle_costs_.setParams(config.max_trans_vel, config.max_scaling_factor, config.scaling_speed);
+    // stencils are per sampled velocity, which only determines the rollout with dwa
+    obstacle_costs_.setStencilCache(config.stencil_cache && config.use_dwa);
+    obstacle_costs_.setDistanceField(config.distance_field);
+    obstacle_costs_.setPyramid(config.costmap_pyramid);
+    costmap_snapshot_ = config.costmap_snapshot;
+    obstacle_costs_.setSnapshot(costmap_snapshot_ ? &snapshot_ : NULL);
+
+    // path and alignment costs have the same targets, so they can share their grid
+    base_local_planner::MapGridEngine* engine = config.shared_map_grids ? &map_grid_engine_ : NULL;
+    path_costs_.setEngine(engine);
+    goal_costs_.setEngine(engine);
+    goal_front_costs_.setEngine(engine);
+    alignment_costs_.setEngine(engine);
+    map_grid_engine_.setIncremental(config.incremental_map_grids);
+    // the map grid lookups of a cycle stay within sim_time at full speed of the robot
+    roi_map_grids_ = config.roi_map_grids && config.shared_map_grids;
+    sim_time_ = config.sim_time;
 
     twirling_costs_.setScale(config.twirling_scale);
 	//#!
     probability_costs_.setScale(PROB_COST_SCALE);       
+    probability_costs_.setPolar(config.polar_probability, config.polar_discount);
 	//#!
     int vx_samp, vy_samp, vth_samp;
     vx_samp = config.vx_samples;
@@ -116,16 +138,45 @@ namespace dwa_local_planner2 {
     vsamples_[1] = vy_samp;
     vsamples_[2] = vth_samp;
  
+    scored_sampling_planner_.setThreads(config.scoring_threads);
+    scored_sampling_planner_.setBatchScoring(config.batch_scoring);
+    scored_sampling_planner_.setBoundPruning(config.bound_pruning);
+
+    // without dwa the trajectory velocities are not the sampled ones, so there is nothing to refine around
+    adaptive_sampling_ = config.adaptive_sampling && config.use_dwa;
+    // a deadline puts the last command first
+    warm_start_ = (config.warm_start || config.deadline_fraction > 0) && config.use_dwa;
+    if ((config.adaptive_sampling || config.warm_start) && !config.use_dwa) {
+      ROS_WARN("adaptive_sampling and warm_start need use_dwa, sampling the fixed grid only");
+    }
+    refine_candidates_ = config.refine_candidates;
+    refine_samples_ = config.refine_samples;
+    warm_start_samples_ = config.warm_start_samples;
+    // thinning the grid may miss its best trajectory, so it is left to an explicit warm start,
+    // with only a deadline the rest of the grid is searched in full
+    warm_start_grid_fraction_ = config.warm_start ? config.warm_start_grid_fraction : 1.0;
+
+    // with a deadline the grid may be cut short, so it is handed out coarse to fine
+    deadline_fraction_ = config.deadline_fraction;
+    generator_.setSpreadOrder(deadline_fraction_ > 0);
+    scored_sampling_planner_.setCritics(config.fused_scoring ? fused_critics_ : critics_);
 
   }
 
   DWAPlanner2::DWAPlanner2(std::string name, base_local_planner::LocalPlannerUtil *planner_util) :
       planner_util_(planner_util),
       obstacle_costs_(planner_util->getCostmap()),
+      map_grid_engine_(planner_util->getCostmap()),
       path_costs_(planner_util->getCostmap()),
       goal_costs_(planner_util->getCostmap(), 0.0, 0.0, true),
       goal_front_costs_(planner_util->getCostmap(), 0.0, 0.0, true),
-      alignment_costs_(planner_util->getCostmap())
+      alignment_costs_(planner_util->getCostmap()),
+      grid_costs_(planner_util->getCostmap(),
+          ObstacleTerm(&obstacle_costs_),
+          MapGridTerm(&goal_front_costs_),
+          MapGridTerm(&alignment_costs_),
+          MapGridTerm(&path_costs_),
+          MapGridTerm(&goal_costs_))
   {
     ros::NodeHandle private_nh("~/" + name);
 
@@ -169,23 +220,33 @@ namespace dwa_local_planner2 {
 
     // set up all the cost functions that will be applied in order
     // (any function returning negative values will abort scoring, so the order can improve performance)
-    std::vector<base_local_planner::TrajectoryCostFunction*> critics;
-    critics.push_back(&oscillation_costs_); // discards oscillating motions (assisgns cost -1)
-    critics.push_back(&obstacle_costs_); // discards trajectories that move into obstacles
-    critics.push_back(&goal_front_costs_); // prefers trajectories that make the nose go towards (local) nose goal
-    critics.push_back(&alignment_costs_); // prefers trajectories that keep the robot nose on nose path
-    critics.push_back(&path_costs_); // prefers trajectories on global path
-    critics.push_back(&goal_costs_); // prefers trajectories that go towards (local) goal, based on wave propagation
-    critics.push_back(&twirling_costs_); // optionally prefer trajectories that don't spin
-    critics.push_back(&probability_costs_); //#! prefer trajectories that avoid dynamic obstacles
+    critics_.push_back(&oscillation_costs_); // discards oscillating motions (assisgns cost -1)
+    critics_.push_back(&obstacle_costs_); // discards trajectories that move into obstacles
+    critics_.push_back(&goal_front_costs_); // prefers trajectories that make the nose go towards (local) nose goal
+    critics_.push_back(&alignment_costs_); // prefers trajectories that keep the robot nose on nose path
+    critics_.push_back(&path_costs_); // prefers trajectories on global path
+    critics_.push_back(&goal_costs_); // prefers trajectories that go towards (local) goal, based on wave propagation
+    critics_.push_back(&twirling_costs_); // optionally prefer trajectories that don't spin
+    critics_.push_back(&probability_costs_); //#! prefer trajectories that avoid dynamic obstacles
+
+    // the same chain with the grid based critics evaluated in one pass, in the same order
+    fused_critics_.push_back(&oscillation_costs_);
+    fused_critics_.push_back(&grid_costs_);
+    fused_critics_.push_back(&twirling_costs_);
+    fused_critics_.push_back(&probability_costs_);
 
     // trajectory generators
     std::vector<base_local_planner::TrajectorySampleGenerator*> generator_list;
     generator_list.push_back(&generator_);
 
-    scored_sampling_planner_ = base_local_planner::SimpleScoredSamplingPlanner(generator_list, critics);
+    scored_sampling_planner_ = ScoredSamplingPlanner2(generator_list, critics_);
 
     private_nh.param("cheat_factor", cheat_factor_, 1.0);
+
+    coverage_ = 0.0;
+    roi_map_grids_ = false;
+    costmap_snapshot_ = false;
+    footprint_radius_ = 0.0;
   }
 
   // used for visualization only, total_costs are not really total costs
@@ -213,8 +274,40 @@ namespace dwa_local_planner2 {
     return planner_util_->setPlan(orig_global_plan);
   }
 
-  void DWAPlanner2::setProbability(std::vector<double> &arr){
-    safety_direction_ = arr;
+  namespace {
+    struct CostLess {
+      CostLess(const std::vector<base_local_planner::Trajectory>& trajs) : trajs_(trajs) {}
+      bool operator()(unsigned int a, unsigned int b) const { return trajs_[a].cost_ < trajs_[b].cost_; }
+      const std::vector<base_local_planner::Trajectory>& trajs_;
+    };
+  }
+
+  void DWAPlanner2::selectSeeds(const std::vector<base_local_planner::Trajectory>& explored,
+      unsigned int num_seeds, std::vector<Eigen::Vector3f>& seeds) {
+    std::vector<unsigned int> legal;
+    for (unsigned int i = 0; i < explored.size(); ++i) {
+      if (explored[i].cost_ >= 0) {
+        legal.push_back(i);
+      }
+    }
+    // stable, so equal costs keep the sample order as in the search
+    std::stable_sort(legal.begin(), legal.end(), CostLess(explored));
+    seeds.clear();
+    for (unsigned int i = 0; i < legal.size() && i < num_seeds; ++i) {
+      const base_local_planner::Trajectory& traj = explored[legal[i]];
+      seeds.push_back(Eigen::Vector3f(traj.xv_, traj.yv_, traj.thetav_));
+    }
+  }
+
+  void DWAPlanner2::setProbability(const std::vector<double> &arr, const ros::Time& stamp){
+    boost::shared_ptr<DirectionProbability> safety_direction(new DirectionProbability());
+    safety_direction->stamp = stamp;
+    safety_direction->probability = arr;
+    setProbability(boost::shared_ptr<const DirectionProbability>(safety_direction));
+  }
+
+  void DWAPlanner2::setProbability(const boost::shared_ptr<const DirectionProbability>& safety_direction){
+    boost::atomic_store(&safety_direction_, safety_direction);
   }
 
   /**
@@ -236,6 +329,20 @@ namespace dwa_local_planner2 {
         &limits,
         vsamples_);
     generator_.generateTrajectory(pos, vel, vel_samples, traj);
+    {
+      // the snapshot, distance fields and pyramid are of the last findBestPath(), which may have
+      // been cycles ago while stopping and rotating, so take them again from the costmap as it is now
+      costmap_2d::Costmap2D* costmap = planner_util_->getCostmap();
+      boost::unique_lock<costmap_2d::Costmap2D::mutex_t> lock(*costmap->getMutex(), boost::defer_lock);
+      if (costmap_snapshot_) {
+        lock.lock();
+        snapshot_.take(*costmap, pos[0], pos[1], sim_time_ * limits.max_trans_vel + footprint_radius_);
+      }
+      if (obstacle_costs_.prepare() == false) {
+        ROS_WARN("The obstacle cost function failed to prepare");
+        return false;
+      }
+    }
     double cost = scored_sampling_planner_.scoreTrajectory(traj, -1);
     //if the trajectory is a legal one... the check passes
     if(cost >= 0) {
@@ -258,6 +365,8 @@ namespace dwa_local_planner2 {
     }
 
     obstacle_costs_.setFootprint(footprint_spec);
+    double inscribed_radius;
+    costmap_2d::calculateMinAndMaxDistances(footprint_spec, inscribed_radius, footprint_radius_);
 
     // costs for going away from path
     path_costs_.setTargetPoses(global_plan_);
@@ -286,7 +395,16 @@ namespace dwa_local_planner2 {
       sin(angle_to_goal);
 
     goal_front_costs_.setTargetPoses(front_global_plan);
-    probability_costs_.setDirectionProbability(safety_direction_); //#!
+    //#!
+    boost::shared_ptr<const DirectionProbability> safety_direction = boost::atomic_load(&safety_direction_);
+    if (safety_direction) {
+      probability_costs_.setDirectionProbability(safety_direction->probability);
+      probability_costs_.setPolarProbability(safety_direction->polar);
+    } else {
+      probability_costs_.setDirectionProbability(std::vector<double>());
+      probability_costs_.setPolarProbability(base_local_planner::PolarProbability());
+    }
+    //#!
 
     // keeping the nose on the path
     if (sq_dist > forward_point_distance_ * forward_point_distance_ * cheat_factor_) {
@@ -312,6 +430,12 @@ namespace dwa_local_planner2 {
     //make sure that our configuration doesn't change mid-run
     boost::mutex::scoped_lock l(configuration_mutex_);
 
+    if (deadline_fraction_ > 0) {
+      scored_sampling_planner_.setDeadline(ros::WallTime::now() + ros::WallDuration(deadline_fraction_ * sim_period_));
+    } else {
+      scored_sampling_planner_.setDeadline(ros::WallTime());
+    }
+
     Eigen::Vector3f pos(global_pose.getOrigin().getX(), global_pose.getOrigin().getY(), tf::getYaw(global_pose.getRotation()));
     Eigen::Vector3f vel(global_vel.getOrigin().getX(), global_vel.getOrigin().getY(), tf::getYaw(global_vel.getRotation()));
     geometry_msgs::PoseStamped goal_pose = global_plan_.back();
@@ -325,10 +449,80 @@ namespace dwa_local_planner2 {
         &limits,
         vsamples_);
 
+    // the command of the last cycle, if it was legal
+    bool warm_start = warm_start_ && result_traj_.cost_ >= 0;
+    Eigen::Vector3f previous_vel(result_traj_.xv_, result_traj_.yv_, result_traj_.thetav_);
+
     result_traj_.cost_ = -7;
-    // find best trajectory by sampling and scoring the samples
+    // find best trajectory by sampling and scoring the samples, passes in order of priority
     std::vector<base_local_planner::Trajectory> all_explored;
-    scored_sampling_planner_.findBestTrajectory(result_traj_, &all_explored);
+    unsigned int planned = 0, covered = 0;
+    // the costmap changed since the last cycle
+    map_grid_engine_.reset();
+    // no footprint of a trajectory leaves this disc
+    double reach = sim_time_ * limits.max_trans_vel + footprint_radius_;
+    if (roi_map_grids_) {
+      // nor does the forward point of the goal front and alignment costs
+      map_grid_engine_.setRegionOfInterest(pos[0], pos[1], reach + forward_point_distance_);
+    } else {
+      map_grid_engine_.setRegionOfInterest(0.0, 0.0, 0.0);
+    }
+    bool prepared;
+    {
+      // with a snapshot the critics are prepared from the same costmap the snapshot is
+      // taken from, so every trajectory is scored against the same costs. move_base
+      // holds the costmap lock across computeVelocityCommands() anyway, releasing it
+      // here does not let the costmap update meanwhile
+      costmap_2d::Costmap2D* costmap = planner_util_->getCostmap();
+      boost::unique_lock<costmap_2d::Costmap2D::mutex_t> lock(*costmap->getMutex(), boost::defer_lock);
+      if (costmap_snapshot_) {
+        lock.lock();
+        snapshot_.take(*costmap, pos[0], pos[1], reach);
+      }
+      prepared = scored_sampling_planner_.prepareCritics();
+    }
+    if (prepared) {
+      // cost of the best trajectory so far, later passes only return better ones
+      double best_cost = -1;
+      base_local_planner::Trajectory pass_traj;
+
+      if (warm_start) {
+        // consecutive cycles are similar, so search around the last command first
+        // to start the rest of the search with a good bound
+        generator_.refineAround(std::vector<Eigen::Vector3f>(1, previous_vel), warm_start_samples_);
+        planned += generator_.getNumSamples();
+        if (scored_sampling_planner_.searchBestTrajectory(result_traj_, &all_explored)) {
+          best_cost = result_traj_.cost_;
+        }
+        covered += scored_sampling_planner_.getNumCovered();
+        // the neighbourhood of the last command already holds a good trajectory, so the grid
+        // only has to look for better ones elsewhere and can be thinned
+        generator_.resumeGrid(best_cost >= 0 ? warm_start_grid_fraction_ : 1.0);
+      }
+
+      planned += generator_.getNumSamples();
+      if (scored_sampling_planner_.searchBestTrajectory(pass_traj, &all_explored, best_cost)) {
+        result_traj_ = pass_traj;
+        best_cost = pass_traj.cost_;
+      }
+      covered += scored_sampling_planner_.getNumCovered();
+
+      if (adaptive_sampling_ && !scored_sampling_planner_.timedOut()) {
+        // refine around the best samples so far, within the same dynamic window
+        std::vector<Eigen::Vector3f> seeds;
+        selectSeeds(all_explored, refine_candidates_, seeds);
+        generator_.refineAround(seeds, refine_samples_);
+        planned += generator_.getNumSamples();
+        if (scored_sampling_planner_.searchBestTrajectory(pass_traj, &all_explored, best_cost)) {
+          result_traj_ = pass_traj;
+        }
+        covered += scored_sampling_planner_.getNumCovered();
+      }
+    }
+    coverage_ = planned > 0 ? double(covered) / planned : 0.0;
+    if (deadline_fraction_ > 0) {
+      ROS_DEBUG("Covered %u of %u velocity samples (%.0f%%) before the deadline", covered, planned, coverage_ * 100);
+    }
 
     if(publish_traj_pc_)
     {
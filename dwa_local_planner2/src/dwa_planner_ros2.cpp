@@ -56,11 +56,16 @@
 #define MAX_VAL 10000
 #define MIN_VAL -10000
 #define COLL_PROB_ALPHA 0.8
-#define COLL_PROB_BETA  0.05
+#define COLL_PROB_BETA  0.5     //per second of time to collision, 0.05 per scan period at the 10Hz perception rate it was tuned at
 #define SIGMA   0.4
 #define CORR    1/sqrt(2 * M_PI * SIGMA)
 #define GAUSS_ALPHA  0.1
 #define EPSILON 0.0001
+#define STATIC_OBS_DIST 0.20    //sensed points within this distance of the static map are not dynamic
+#define DIRECTION_BINS 360      //default number of directions the safety probability is given for
+#define POLAR_RANGE_RESOLUTION 0.1    //range bins of the polar collision probabilities, in meters
+#define POLAR_RANGE_BINS 40
+#define POLAR_OBSTACLE_MARGIN 0.3     //range before the nearest point of an obstacle from which it may be hit
 
 bool no_obstacles_ = false;
 //#!
@@ -108,8 +113,15 @@ namespace dwa_local_planner2 {
   }
 
   DWAPlannerROS2::DWAPlannerROS2() : initialized_(false),
-      odom_helper_("odom"), setup_(false) {
+      odom_helper_("odom"), setup_(false), async_perception_(false), perception_thread_(NULL) {
+      setDirectionBins(DIRECTION_BINS);
+  }
+
+  void DWAPlannerROS2::setDirectionBins(int direction_bins){
+      direction_bins_ = std::max(direction_bins, 1);
 
+      //gaussian of the angle in degrees between a bin and an obstacle, cut off where it no longer lowers the safety by EPSILON
+      safety_kernel_.build(direction_bins_, GAUSS_ALPHA, SIGMA, EPSILON);
   }
 
   void DWAPlannerROS2::mapProcess(const nav_msgs::OccupancyGrid& map){
@@ -117,223 +129,207 @@ namespace dwa_local_planner2 {
       ROS_INFO_STREAM(map.header.frame_id);
       ROS_INFO("map initialize");
 
-      map_inf map_info;
-      map_info.size_x = map.info.width;
-      map_info.size_y = map.info.height;
-      map_info.scale = map.info.resolution;
-      map_info.origin_x = map.info.origin.position.x + (map_info.size_x / 2) * map_info.scale;
-      map_info.origin_y = map.info.origin.position.y + (map_info.size_y / 2) * map_info.scale;
-
-      float w_x, w_y;
-
-      map_position_.clear();
+      map_info_.size_x = map.info.width;
+      map_info_.size_y = map.info.height;
+      map_info_.scale = map.info.resolution;
+      map_info_.origin_x = map.info.origin.position.x + (map_info_.size_x / 2) * map_info_.scale;
+      map_info_.origin_y = map.info.origin.position.y + (map_info_.size_y / 2) * map_info_.scale;
+
+      static_obs_grid_.assign(map.info.width * map.info.height, 0);
+
+      //cell offsets within STATIC_OBS_DIST, used to dilate every occupied cell
+      int radius = (int)std::ceil(STATIC_OBS_DIST / map_info_.scale);
+      std::vector<int> disc_dx, disc_dy;
+      for (int dy = -radius; dy <= radius; dy++) {
+          for (int dx = -radius; dx <= radius; dx++) {
+              if((dx * dx + dy * dy) * map_info_.scale * map_info_.scale <= STATIC_OBS_DIST * STATIC_OBS_DIST){
+                  disc_dx.push_back(dx);
+                  disc_dy.push_back(dy);
+              }
+          }
+      }
 
-      for (std::size_t j=0; j < map_info.size_y; j++) {
-          for (std::size_t i=0; i < map_info.size_x; i++) {
-              if(map.data[MAP_INDEX(map_info, i, j)]==100){
-                  // convert to world position
-                  w_x = MAP_WXGX(map_info, i);
-                  w_y = MAP_WYGY(map_info, j);
-                  map_position_.push_back(std::make_pair(w_x, w_y));
+      for (int j = 0; j < (int)map.info.height; j++) {
+          for (int i = 0; i < (int)map.info.width; i++) {
+              if(map.data[MAP_INDEX(map_info_, i, j)] == 100){
+                  for (std::size_t k = 0; k < disc_dx.size(); k++) {
+                      int n_i = i + disc_dx[k];
+                      int n_j = j + disc_dy[k];
+                      if(MAP_VALID(map_info_, n_i, n_j)){
+                          static_obs_grid_[MAP_INDEX(map_info_, n_i, n_j)] = 1;
+                      }
+                  }
               }
           }
       }
   }
 
-  float obstacles_prev[10][2];
-  float time_to_collide[10][2];
-  int cnt_ = 1;
+  bool DWAPlannerROS2::getPoseAt(const ros::Time& stamp, tf::Stamped<tf::Pose>& pose){
+    tf::Stamped<tf::Pose> robot_pose;
+    robot_pose.setIdentity();
+    robot_pose.frame_id_ = costmap_ros_->getBaseFrameID();
+    robot_pose.stamp_ = stamp;
+    try{
+        tf_->transformPose(costmap_ros_->getGlobalFrameID(), robot_pose, pose);
+        return true;
+    }
+    catch(tf::TransformException& ex){
+        //scans may be newer than the latest transform, the latest pose is the closest then
+        ROS_DEBUG_NAMED("dwa_local_planner2", "No robot pose at the scan stamp: %s", ex.what());
+        return costmap_ros_->getRobotPose(pose);
+    }
+  }
 
   void DWAPlannerROS2::computeTTC(){
     float obs_curr_x, obs_curr_y;     //obstacle position
 
-    if(cnt_ % 2 != 0){
-
-        findObstacles();
-
-        if(no_obstacles_){
-            for(int idx = 0; idx < rcv_msg_.ranges.size(); idx++){
-                robot_safe_dir_.push_back(1.0);
-            }
-            dp_->setProbability(robot_safe_dir_);
+    //each scan is processed once, the probabilities of the last one stay with the planner until the next.
+    //the slot version may lag behind its scan, so scans are told apart by the message itself, which
+    //stays allocated while last_scan_ holds it. The slot starts out with an empty scan
+    sensor_msgs::LaserScan::ConstPtr scan = scan_slot_.load();
+    if(scan == last_scan_ || scan->ranges.empty()){
+        return;
+    }
+    last_scan_ = scan;
 
-            //clear
-            curr_obs_.clear();
-            obs_direction_.clear();
-            obs_safe_prob_.clear();
-            return;
-        }
+    //robot motion and obstacle motion are both measured between scan stamps
+    ros::Time stamp = scan->header.stamp.isZero() ? ros::Time::now() : scan->header.stamp;
+    if( ! getPoseAt(scan->header.stamp, perception_pose_)){
+        return;
+    }
+    scan_ = scan;
+    robot_safe_dir_.clear();
 
-        float robot_vec[2] = {current_pose_.getOrigin().getX() - previous_pose_.getOrigin().getX(),
-                               current_pose_.getOrigin().getY() - previous_pose_.getOrigin().getY()};   //robot vec
-        float obs_vec[2] = {0, 0};
-        float v_rel[2];
-
-        for(int idx = 0; idx < curr_obs_.size(); idx++){
-            obs_curr_x = curr_obs_[idx].first;
-            obs_curr_y = curr_obs_[idx].second;
-
-            float min_dist_ = MAX_VAL;
-            int min_idx;
-
-            //find previous obstacle j who has minimum distance with obstacle idx
-            for(int j = 0; j < 10 ; j++){
-                float dist_ = sqrt(powf(obs_curr_x - obstacles_prev[j][0], 2.0) + powf(obs_curr_y - obstacles_prev[j][1], 2.0));
-                if(dist_ < min_dist_){
-                    min_dist_ = dist_;
-                    min_idx = j;
-                }
-            }
-            obs_vec[0] = obs_curr_x - obstacles_prev[min_idx][0];
-            obs_vec[1] = obs_curr_y - obstacles_prev[min_idx][1];   //obs vec
-
-            v_rel[0] = robot_vec[0] - obs_vec[0];
-            v_rel[1] = robot_vec[1] - obs_vec[1];
-
-            float robot_vec_s  = sqrt(powf(robot_vec[0], 2.0) + powf(robot_vec[1], 2.0));
-            float obs_vec_s = sqrt(powf(obs_vec[0], 2.0) + powf(obs_vec[1], 2.0));
-            float f_dot = robot_vec[0] * obs_vec[0] + robot_vec[1] * obs_vec[1];    //inner product
-            float cos_theta = f_dot / (robot_vec_s * obs_vec_s);    //cosine theta between 2 vec
-
-            float d_rel_s = sqrt(powf(obs_curr_x - current_pose_.getOrigin().getX(), 2.0)
-                               + powf(obs_curr_y - current_pose_.getOrigin().getY(), 2.0));
-            float v_rel_s = sqrt(powf(v_rel[0], 2.0) + powf(v_rel[1], 2.0));
-
-            float ttc = d_rel_s / (v_rel_s * cos_theta);
-
-            float safety_prob = 1 - COLL_PROB_ALPHA * powf(M_E, -1 * (COLL_PROB_BETA * ttc) * (COLL_PROB_BETA * ttc) );
-
-            obs_safe_prob_.push_back(safety_prob);
-       }//end for
-
-        //update previous state to current state
-        previous_pose_ = current_pose_;
-
-        for(int idx = 0; idx < 10; idx++){
-            if(idx < curr_obs_.size()){
-                obstacles_prev[idx][0] = curr_obs_[idx].first;
-                obstacles_prev[idx][1] = curr_obs_[idx].second;
-            }
-            else{
-                obstacles_prev[idx][0] = MAX_VAL;
-                obstacles_prev[idx][1] = MAX_VAL;
-            }
-        }
+    findObstacles();
 
-        double gauss_prob;
-        double min_prob = MAX_VAL;
-
-        //compute safe probability for all directions
-        for(int idx = 0; idx < rcv_msg_.ranges.size(); idx++){
-            min_prob = MAX_VAL;
-            for(int j = 0;  j < curr_obs_.size(); j++){
-                gauss_prob = 1 - (CORR * powf(M_E, -1 * (GAUSS_ALPHA*(idx - obs_direction_[j])) * (GAUSS_ALPHA*(idx - obs_direction_[j])) / (2*SIGMA))
-                         * (1/CORR)) * (1 - obs_safe_prob_[j]);
-                if(min_prob > gauss_prob){
-                    min_prob = gauss_prob;
-                }
-            }
-            robot_safe_dir_.push_back(min_prob);
-        }
+    //associate the obstacles of this scan with the tracked ones
+    double dt = previous_time_.isZero() ? 0.0 : (stamp - previous_time_).toSec();
+    previous_time_ = stamp;
+    std::vector<int> assoc;
+    tracker_.update(curr_obs_, dt, assoc);
 
-        int min_prob_idx;
-        int max_prob_idx;
-        if( !((1 - robot_safe_dir_[0]) < EPSILON && (1 - robot_safe_dir_[rcv_msg_.ranges.size() - 1]) < EPSILON) ){ //obs in front of robot head direction
-
-            if((1 - robot_safe_dir_[0]) >= EPSILON){ // 0 ~
-                min_prob_idx = 0;   max_prob_idx = 0;
-
-                for(int i = 0 ; i < rcv_msg_.ranges.size(); i++){   //find index with minimum prob value, last index which robot_safe_dir_[index] < 1
-                    if(robot_safe_dir_[i] < robot_safe_dir_[min_prob_idx]){
-                        min_prob_idx = i;
-                    }
-                    if((1 - robot_safe_dir_[i]) < EPSILON){
-                        max_prob_idx = i;
-                        break;
-                    }
-                }
-
-                for(int i = min_prob_idx + 1; i <= max_prob_idx; i++){  //update probabilities for the opposite side
-                    if(min_prob_idx - (i - min_prob_idx) < 0){
-                        int offset = min_prob_idx - (i - min_prob_idx);
-                        robot_safe_dir_[rcv_msg_.ranges.size() + offset] = robot_safe_dir_[i];
-                    }
-                }
-            }
-
-            else if((1 - robot_safe_dir_[rcv_msg_.ranges.size() - 1]) >= EPSILON){   // ~ 359
-                int max_i = rcv_msg_.ranges.size() - 1;
-                min_prob_idx = max_i;   max_prob_idx = max_i;
-
-                for(int i = max_i ; i >= 0; i--){   //find index with minimum prob value, last index which robot_safe_dir_[index] < 1
-                    if(robot_safe_dir_[i] < robot_safe_dir_[min_prob_idx]){
-                        min_prob_idx = i;
-                    }
-                    if((1 - robot_safe_dir_[i]) < EPSILON){
-                        max_prob_idx = i;
-                        break;
-                    }
-                }
-
-                for(int i = min_prob_idx - 1; i >= max_prob_idx; i--){  //update probabilities for the opposite side
-                    if(min_prob_idx - (i - min_prob_idx) > max_i){
-                        int offset = min_prob_idx - (i - min_prob_idx);
-                        robot_safe_dir_[offset - rcv_msg_.ranges.size()] = robot_safe_dir_[i];
-                    }
-                }
-            }
-        }
+    //robot velocity over the same scan period as the tracks, previous_pose_ follows every processed scan
+    float robot_vec[2] = {0, 0};   //robot vec
+    if(dt > 0){
+        robot_vec[0] = (perception_pose_.getOrigin().getX() - previous_pose_.getOrigin().getX()) / dt;
+        robot_vec[1] = (perception_pose_.getOrigin().getY() - previous_pose_.getOrigin().getY()) / dt;
+    }
+    previous_pose_ = perception_pose_;
 
-        //send robot_safe_dir_ to base_local_planner::ProbabilityCostFunction
-        dp_->setProbability(robot_safe_dir_);
+    if(no_obstacles_){
+        robot_safe_dir_.assign(direction_bins_, 1.0);
+        dp_->setProbability(robot_safe_dir_, scan_->header.stamp);
 
         //clear
         curr_obs_.clear();
         obs_direction_.clear();
         obs_safe_prob_.clear();
+        return;
+    }
+
+    float obs_vec[2] = {0, 0};
+    float v_rel[2];
+
+    for(int idx = 0; idx < curr_obs_.size(); idx++){
+        obs_curr_x = curr_obs_[idx].first;
+        obs_curr_y = curr_obs_[idx].second;
+
+        //velocity of the tracked obstacle, so that the time to collision is in seconds whatever the scan rate
+        const ObstacleTracker::Track& track = tracker_.getTracks()[assoc[idx]];
+        obs_vec[0] = track.vx;
+        obs_vec[1] = track.vy;   //obs vec
+
+        //new tracks start at rest, obstacles that do not move are left to the costmap
+        float obs_vec_s = sqrt(powf(obs_vec[0], 2.0) + powf(obs_vec[1], 2.0));
+        if(obs_vec_s == 0){
+            obs_safe_prob_.push_back(1.0);
+            continue;
+        }
+
+        v_rel[0] = robot_vec[0] - obs_vec[0];
+        v_rel[1] = robot_vec[1] - obs_vec[1];
+
+        float robot_vec_s  = sqrt(powf(robot_vec[0], 2.0) + powf(robot_vec[1], 2.0));
+        float f_dot = robot_vec[0] * obs_vec[0] + robot_vec[1] * obs_vec[1];    //inner product
+        float cos_theta = f_dot / (robot_vec_s * obs_vec_s);    //cosine theta between 2 vec
+
+        float d_rel_s = sqrt(powf(obs_curr_x - perception_pose_.getOrigin().getX(), 2.0)
+                           + powf(obs_curr_y - perception_pose_.getOrigin().getY(), 2.0));
+        float v_rel_s = sqrt(powf(v_rel[0], 2.0) + powf(v_rel[1], 2.0));
+
+        float ttc = d_rel_s / (v_rel_s * cos_theta);
+
+        float safety_prob = 1 - COLL_PROB_ALPHA * powf(M_E, -1 * (COLL_PROB_BETA * ttc) * (COLL_PROB_BETA * ttc) );
+        //no time to collision when the robot stands still
+        if(!std::isfinite(safety_prob)){
+            safety_prob = 1.0;
+        }
+
+        obs_safe_prob_.push_back(safety_prob);
+   }//end for
+
+    //compute safe probability for all directions, the lowest over the obstacles near each
+    //directions are bins of 360 / direction_bins_ degrees from the robot heading, whatever the beams of the scan
+    int num_bins = direction_bins_;
+    robot_safe_dir_.assign(num_bins, 1.0);
+
+    //collision probability by bearing and range from the robot, an obstacle spreads over bearings as above
+    //and over the ranges from just before its nearest point on
+    boost::shared_ptr<DirectionProbability> safety_direction(new DirectionProbability());
+    base_local_planner::PolarProbability& polar = safety_direction->polar;
+    polar.origin_x = perception_pose_.getOrigin().getX();
+    polar.origin_y = perception_pose_.getOrigin().getY();
+    polar.origin_yaw = tf::getYaw(perception_pose_.getRotation());
+    polar.range_resolution = POLAR_RANGE_RESOLUTION;
+    polar.range_bins = POLAR_RANGE_BINS;
+    polar.probability.assign(num_bins * POLAR_RANGE_BINS, 0.0);
+
+    for(int j = 0; j < curr_obs_.size(); j++){
+        double angle = scan_->angle_min + scan_->angle_increment * obs_direction_[j];
+        angle -= 2 * M_PI * std::floor(angle / (2 * M_PI));
+        //a beam on a bin boundary belongs to the bin above it
+        int bin = std::min(int(angle / (2 * M_PI) * num_bins + EPSILON), num_bins - 1);
+
+        int range_start = std::max(0, int((scan_->ranges[obs_direction_[j]] - POLAR_OBSTACLE_MARGIN) / POLAR_RANGE_RESOLUTION));
+
+        safety_kernel_.spread(bin, 1 - obs_safe_prob_[j], &robot_safe_dir_[0],
+                              &polar.probability[0], POLAR_RANGE_BINS, range_start);
     }
-    cnt_++;
+
+    //send robot_safe_dir_ and the polar probabilities to base_local_planner::ProbabilityCostFunction
+    safety_direction->stamp = scan_->header.stamp;
+    safety_direction->probability = robot_safe_dir_;
+    dp_->setProbability(safety_direction);
+
+    //clear
+    curr_obs_.clear();
+    obs_direction_.clear();
+    obs_safe_prob_.clear();
   }
 
   void DWAPlannerROS2::findObstacles(){
 
-      float pt_x, pt_y;
-      float rb_yaw; //robot yaw
-      float w_x = 0, w_y = 0, dist_sq = 0;
-
       int obs_count = 0;
       float min_dist;
-      bool dynamic;
+      bool dynamic = false;
 
       int *p1, *p2, *p3;
       int *grp_start_end;
       float *center_pos;
 
-      rb_yaw = tf::getYaw(current_pose_.getRotation());
-
-      if(rb_yaw < 0){
-          rb_yaw += 2 * M_PI;
-      }
+      float rb_x = perception_pose_.getOrigin().getX();
+      float rb_y = perception_pose_.getOrigin().getY();
+      projector_.project(*scan_, rb_x, rb_y, tf::getYaw(perception_pose_.getRotation()));
+      const std::vector<float>& pt_x = projector_.getX();
+      const std::vector<float>& pt_y = projector_.getY();    //sensed positions
 
       //find dynamic points, add dynamic points to obs_idx_
-      for(int i = 0; i < rcv_msg_.ranges.size() ; i++){
-          if(rcv_msg_.ranges[i] < rcv_msg_.range_max){
-              pt_x = current_pose_.getOrigin().getX()
-                      + rcv_msg_.ranges[i] * std::cos(rcv_msg_.angle_increment * i + rb_yaw);
-              pt_y = current_pose_.getOrigin().getY()
-                      + rcv_msg_.ranges[i] * std::sin(rcv_msg_.angle_increment * i + rb_yaw);    //sensed position
-
-              int j;
-              for(j = 0; j < map_position_.size(); j++){
-                  w_x = map_position_[j].first;     //world map position
-                  w_y = map_position_[j].second;
-                  dist_sq = sqrt(powf(w_x - pt_x, 2.0) + powf(w_y - pt_y, 2.0));
-
-                  if(dist_sq <= 0.20){ //near map
-                      break;
-                  }
-              }
-              if(j == map_position_.size()){
+      for(int i = 0; i < scan_->ranges.size() ; i++){
+          if(projector_.isValid(i)){
+              //sensed points off the static map or far from its occupied cells are dynamic
+              int m_x = MAP_GXWX(map_info_, pt_x[i]);
+              int m_y = MAP_GYWY(map_info_, pt_y[i]);
+              if(!MAP_VALID(map_info_, m_x, m_y) || !static_obs_grid_[MAP_INDEX(map_info_, m_x, m_y)]){
                   dynamic = true;
               }
               if(dynamic){
@@ -387,19 +383,19 @@ namespace dwa_local_planner2 {
       for (int i = 0; i < obs_count; i++) {
           p1[i] = grp_start_end[i*2];     //start index
           p3[i] = grp_start_end[i*2+1];   //end index
-          min_dist = rcv_msg_.range_max;
+          min_dist = scan_->range_max;
 
           for (int j = p1[i]; j <= p3[i]; j++) {
-              if(rcv_msg_.ranges[j] < min_dist){   //find index with minimum distance
-                  min_dist = rcv_msg_.ranges[j];
+              if(scan_->ranges[j] < min_dist){   //find index with minimum distance
+                  min_dist = scan_->ranges[j];
                   p2[i] = j;
               }
           }
       }
 
       //Obstacle exists at robot head direction (remove in case for duplicate count)
-      if(obs_idx_.front() == 0 && obs_idx_.back() == rcv_msg_.ranges.size() - 1){
-          if(rcv_msg_.ranges[p2[0]] >= rcv_msg_.ranges[p2[obs_count - 1]]){
+      if(obs_idx_.front() == 0 && obs_idx_.back() == scan_->ranges.size() - 1){
+          if(scan_->ranges[p2[0]] >= scan_->ranges[p2[obs_count - 1]]){
              p2[0] = p2[obs_count - 1];
           }
           p1[0] = p1[obs_count - 1];
@@ -420,12 +416,12 @@ namespace dwa_local_planner2 {
           float a_vec_sq, b_vec_sq, a_b_in;
           float p, q;
 
-          tri_a_x = rcv_msg_.ranges[p1[i]] * std::cos(rcv_msg_.angle_increment * p1[i]);    //A
-          tri_a_y = rcv_msg_.ranges[p1[i]] * std::sin(rcv_msg_.angle_increment * p1[i]);
-          tri_c_x = rcv_msg_.ranges[p2[i]] * std::cos(rcv_msg_.angle_increment * p2[i]);    //C
-          tri_c_y = rcv_msg_.ranges[p2[i]] * std::sin(rcv_msg_.angle_increment * p2[i]);
-          tri_b_x = rcv_msg_.ranges[p3[i]] * std::cos(rcv_msg_.angle_increment * p3[i]);    //B
-          tri_b_y = rcv_msg_.ranges[p3[i]] * std::sin(rcv_msg_.angle_increment * p3[i]);
+          tri_a_x = pt_x[p1[i]] - rb_x;    //A
+          tri_a_y = pt_y[p1[i]] - rb_y;
+          tri_c_x = pt_x[p2[i]] - rb_x;    //C
+          tri_c_y = pt_y[p2[i]] - rb_y;
+          tri_b_x = pt_x[p3[i]] - rb_x;    //B
+          tri_b_y = pt_y[p3[i]] - rb_y;
 
           a_vec_x = tri_a_x - tri_c_x; //CA == OA - OC
           a_vec_y = tri_a_y - tri_c_y;
@@ -446,7 +442,7 @@ namespace dwa_local_planner2 {
                 //obs_count_mod--;
           }
           else{
-              curr_obs_.push_back(make_pair(current_pose_.getOrigin().getX() + center_pos[2*i], current_pose_.getOrigin().getY() + center_pos[2*i + 1]));    //obs position
+              curr_obs_.push_back(make_pair(rb_x + center_pos[2*i], rb_y + center_pos[2*i + 1]));    //obs position
               obs_direction_.push_back(p2[i]);   //direction of min
           }
       }
@@ -467,17 +463,30 @@ namespace dwa_local_planner2 {
   }
 
   void DWAPlannerROS2::scanCallBack(const sensor_msgs::LaserScan::ConstPtr& msg){
-      //laser data to rcv_msg_
-      rcv_msg_.header = msg->header;
-      rcv_msg_.angle_min = msg->angle_min;
-      rcv_msg_.angle_max = msg->angle_max;
-      rcv_msg_.angle_increment = msg->angle_increment;
-      rcv_msg_.time_increment = msg->time_increment;
-      rcv_msg_.scan_time = msg->scan_time;
-      rcv_msg_.range_min = msg->range_min;
-      rcv_msg_.range_max = msg->range_max;
-      rcv_msg_.ranges = msg->ranges;
-      rcv_msg_.intensities = msg->intensities;
+      //hand the message itself to computeTTC()
+      scan_slot_.publish(msg);
+      if(async_perception_){
+          boost::mutex::scoped_lock lock(scan_mutex_);
+          scan_cond_.notify_one();
+      }
+  }
+
+  void DWAPlannerROS2::perceptionThread(){
+      unsigned int version = 0;
+      try{
+          while(true){
+              {
+                  boost::mutex::scoped_lock lock(scan_mutex_);
+                  while(scan_slot_.getVersion() == version){
+                      scan_cond_.wait(lock);
+                  }
+                  version = scan_slot_.getVersion();
+              }
+              computeTTC();
+          }
+      }
+      catch(boost::thread_interrupted&){
+      }
   }
 
   void DWAPlannerROS2::initialize(
@@ -518,8 +527,22 @@ namespace dwa_local_planner2 {
 
 
       //#!
+      private_nh.param("async_perception", async_perception_, false);
+      int direction_bins;
+      private_nh.param("direction_bins", direction_bins, DIRECTION_BINS);
+      setDirectionBins(direction_bins);
       scan_sub = private_nh.subscribe<sensor_msgs::LaserScan>("/scan", 1, &DWAPlannerROS2::scanCallBack, this);
 
+      double tracker_gate_dist;
+      int tracker_max_missed;
+      private_nh.param("tracker_gate_dist", tracker_gate_dist, 0.5);
+      private_nh.param("tracker_max_missed", tracker_max_missed, 2);
+      if( ! (tracker_gate_dist > 0)){
+          ROS_WARN("tracker_gate_dist must be positive, using 0.5 instead of %f", tracker_gate_dist);
+          tracker_gate_dist = 0.5;
+      }
+      tracker_.setParameters(tracker_gate_dist, std::max(tracker_max_missed, 0));
+
 
       nav_msgs::GetMap::Request  req;
       nav_msgs::GetMap::Response resp;
@@ -531,6 +554,11 @@ namespace dwa_local_planner2 {
       }
       current_map_ = resp.map;
       mapProcess(current_map_);
+
+      //the pipeline is driven by scans rather than by the controller, which only picks up its results
+      if(async_perception_){
+          perception_thread_ = new boost::thread(boost::bind(&DWAPlannerROS2::perceptionThread, this));
+      }
       //#!
 
     }
@@ -580,6 +608,11 @@ namespace dwa_local_planner2 {
 
   DWAPlannerROS2::~DWAPlannerROS2(){
     //make sure to clean things up
+    if(perception_thread_ != NULL){
+      perception_thread_->interrupt();
+      perception_thread_->join();
+      delete perception_thread_;
+    }
     delete dsrv_;
   }
 
@@ -672,8 +705,9 @@ namespace dwa_local_planner2 {
     std::vector<geometry_msgs::PoseStamped> transformed_plan;
 
     //#!
-    robot_safe_dir_.clear();
-    computeTTC();
+    if( ! async_perception_){
+      computeTTC();
+    }
     //#!
 
     if ( ! planner_util_.getLocalPlan(current_pose_, transformed_plan)) {
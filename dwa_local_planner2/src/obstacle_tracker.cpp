@@ -0,0 +1,187 @@
+/*********************************************************************
+ *
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2017, Open Source Robotics Foundation, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Author: Jeeseon Kim
+ *********************************************************************/
+
+#include <dwa_local_planner2/obstacle_tracker.h>
+
+#include <algorithm>
+#include <cmath>
+
+//smallest gating distance, it is also the cell size of the spatial hash
+#define MIN_GATE_DIST 0.01
+
+namespace dwa_local_planner2 {
+
+  namespace {
+    typedef std::pair<int, int> HashCell;
+    typedef std::pair<HashCell, int> HashEntry;
+
+    //candidate detection/track pair, ordered by distance and then by index for deterministic ties
+    struct Candidate {
+      float dist_sq;
+      int det, track;
+      bool operator<(const Candidate& other) const {
+        if (dist_sq != other.dist_sq) return dist_sq < other.dist_sq;
+        if (det != other.det) return det < other.det;
+        return track < other.track;
+      }
+    };
+
+    inline HashCell hashCell(float x, float y, double cell_size) {
+      return HashCell((int)std::floor(x / cell_size), (int)std::floor(y / cell_size));
+    }
+
+    inline bool entryLess(const HashEntry& a, const HashEntry& b) {
+      return a.first < b.first;
+    }
+  }
+
+  ObstacleTracker::ObstacleTracker(double gate_dist, unsigned int max_missed) :
+      next_id_(0)
+  {
+    setParameters(gate_dist, max_missed);
+  }
+
+  void ObstacleTracker::setParameters(double gate_dist, unsigned int max_missed) {
+    //NaN fails the comparison and is clamped as well
+    gate_dist_ = gate_dist > MIN_GATE_DIST ? gate_dist : MIN_GATE_DIST;
+    max_missed_ = max_missed;
+  }
+
+  void ObstacleTracker::clear() {
+    tracks_.clear();
+  }
+
+  void ObstacleTracker::update(const std::vector<std::pair<float, float> >& detections, double dt, std::vector<int>& assoc) {
+    std::vector<std::pair<float, float> > prev_pos(tracks_.size());
+
+    //constant velocity prediction
+    for (unsigned int i = 0; i < tracks_.size(); ++i) {
+      prev_pos[i] = std::make_pair(tracks_[i].x, tracks_[i].y);
+      if (dt > 0) {
+        tracks_[i].x += tracks_[i].vx * dt;
+        tracks_[i].y += tracks_[i].vy * dt;
+      }
+    }
+
+    //spatial hash of the predicted tracks, sorted by cell so each lookup is a binary search
+    std::vector<HashEntry> hash;
+    hash.reserve(tracks_.size());
+    for (unsigned int i = 0; i < tracks_.size(); ++i) {
+      hash.push_back(HashEntry(hashCell(tracks_[i].x, tracks_[i].y, gate_dist_), i));
+    }
+    std::sort(hash.begin(), hash.end());
+
+    //gather all pairs within the gate from the 3x3 neighbourhood of each detection
+    std::vector<Candidate> candidates;
+    float gate_sq = gate_dist_ * gate_dist_;
+    for (unsigned int d = 0; d < detections.size(); ++d) {
+      HashCell cell = hashCell(detections[d].first, detections[d].second, gate_dist_);
+      for (int dx = -1; dx <= 1; ++dx) {
+        for (int dy = -1; dy <= 1; ++dy) {
+          HashEntry key(HashCell(cell.first + dx, cell.second + dy), 0);
+          std::pair<std::vector<HashEntry>::iterator, std::vector<HashEntry>::iterator> range =
+              std::equal_range(hash.begin(), hash.end(), key, entryLess);
+          for (std::vector<HashEntry>::iterator it = range.first; it != range.second; ++it) {
+            const Track& track = tracks_[it->second];
+            float ex = detections[d].first - track.x;
+            float ey = detections[d].second - track.y;
+            Candidate c;
+            c.dist_sq = ex * ex + ey * ey;
+            if (c.dist_sq <= gate_sq) {
+              c.det = d;
+              c.track = it->second;
+              candidates.push_back(c);
+            }
+          }
+        }
+      }
+    }
+    std::sort(candidates.begin(), candidates.end());
+
+    //greedy nearest-first assignment
+    assoc.assign(detections.size(), -1);
+    std::vector<bool> track_used(tracks_.size(), false);
+    for (unsigned int i = 0; i < candidates.size(); ++i) {
+      const Candidate& c = candidates[i];
+      if (assoc[c.det] >= 0 || track_used[c.track]) {
+        continue;
+      }
+      assoc[c.det] = c.track;
+      track_used[c.track] = true;
+
+      Track& track = tracks_[c.track];
+      if (dt > 0) {
+        track.vx = (detections[c.det].first - prev_pos[c.track].first) / dt;
+        track.vy = (detections[c.det].second - prev_pos[c.track].second) / dt;
+      }
+      track.x = detections[c.det].first;
+      track.y = detections[c.det].second;
+      track.age++;
+      track.missed = 0;
+    }
+
+    //age out tracks that were not observed, remembering where the survivors move to
+    std::vector<int> remap(tracks_.size(), -1);
+    unsigned int kept = 0;
+    for (unsigned int i = 0; i < tracks_.size(); ++i) {
+      if (!track_used[i] && ++tracks_[i].missed > max_missed_) {
+        continue;
+      }
+      remap[i] = kept;
+      tracks_[kept++] = tracks_[i];
+    }
+    tracks_.resize(kept);
+
+    for (unsigned int d = 0; d < detections.size(); ++d) {
+      if (assoc[d] >= 0) {
+        assoc[d] = remap[assoc[d]];
+        continue;
+      }
+      //unmatched detections start new tracks at rest
+      Track track;
+      track.id = next_id_++;
+      track.x = detections[d].first;
+      track.y = detections[d].second;
+      track.vx = 0;
+      track.vy = 0;
+      track.age = 1;
+      track.missed = 0;
+      assoc[d] = tracks_.size();
+      tracks_.push_back(track);
+    }
+  }
+};
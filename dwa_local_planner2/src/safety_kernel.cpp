@@ -0,0 +1,114 @@
+/*********************************************************************
+ *
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2017, Open Source Robotics Foundation, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Author: Jeeseon Kim
+ *********************************************************************/
+
+
+#include <dwa_local_planner2/safety_kernel.h>
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace dwa_local_planner2 {
+
+  void SafetyKernel::build(int direction_bins, double alpha, double sigma, double epsilon) {
+    direction_bins_ = std::max(direction_bins, 1);
+    double bin_degrees = 360.0 / direction_bins_;
+    std::vector<double> half;
+    for (int k = 0; ; k++) {
+      double g = std::exp(-1 * (alpha * k * bin_degrees) * (alpha * k * bin_degrees) / (2 * sigma));
+      if (g < epsilon) {
+        break;
+      }
+      half.push_back(g);
+    }
+    radius_ = half.size() - 1;
+    kernel_.assign(half.rbegin(), half.rend());
+    kernel_.insert(kernel_.end(), half.begin() + 1, half.end());
+  }
+
+  void SafetyKernel::spread(int bin, double weight, double* safety,
+      double* probability, int range_bins, int range_start) const {
+    //offsets from -radius on, fewer than a full turn so that they do not wrap around onto each other
+    int radius = std::min(radius_, direction_bins_ / 2);
+    int count = radius + std::min(radius_, (direction_bins_ - 1) / 2) + 1;
+    int range_count = range_bins - range_start;
+    int idx = bin - radius;
+    if (idx < 0) {
+      idx += direction_bins_;
+    }
+    const double* kernel = &kernel_[radius_ - radius];
+    while (count > 0) {
+      int len = std::min(count, direction_bins_ - idx);
+      lowerSafety(safety + idx, kernel, len, weight);
+      for (int b = 0; probability != NULL && b < len && range_count > 0; b++) {
+        raiseProbability(probability + (idx + b) * range_bins + range_start, range_count, kernel[b] * weight);
+      }
+      kernel += len;
+      count -= len;
+      idx = 0;
+    }
+  }
+
+  void lowerSafety(double* safety, const double* kernel, int n, double weight) {
+    int i = 0;
+#ifdef __SSE2__
+    __m128d v_one = _mm_set1_pd(1.0), v_weight = _mm_set1_pd(weight);
+    for (; i + 2 <= n; i += 2) {
+      __m128d prob = _mm_sub_pd(v_one, _mm_mul_pd(_mm_loadu_pd(kernel + i), v_weight));
+      //minpd returns its second operand if either is NaN, as std::min() does
+      _mm_storeu_pd(safety + i, _mm_min_pd(prob, _mm_loadu_pd(safety + i)));
+    }
+#endif
+    lowerSafetyScalar(safety + i, kernel + i, n - i, weight);
+  }
+
+  void lowerSafetyScalar(double* safety, const double* kernel, int n, double weight) {
+    for (int i = 0; i < n; i++) {
+      safety[i] = std::min(safety[i], 1 - kernel[i] * weight);
+    }
+  }
+
+  void raiseProbability(double* probability, int n, double value) {
+    for (int i = 0; i < n; i++) {
+      probability[i] = std::max(probability[i], value);
+    }
+  }
+
+};
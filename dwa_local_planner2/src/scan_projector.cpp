@@ -0,0 +1,106 @@
+/*********************************************************************
+ *
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2017, Open Source Robotics Foundation, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Author: Jeeseon Kim
+ *********************************************************************/
+
+#include <dwa_local_planner2/scan_projector.h>
+
+#include <cmath>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace dwa_local_planner2 {
+
+  void ScanProjector::updateDirections(const sensor_msgs::LaserScan& scan) {
+    unsigned int num_beams = scan.ranges.size();
+    if (scan.angle_min == angle_min_ && scan.angle_increment == angle_increment_ && num_beams == cos_.size()) {
+      return;
+    }
+    angle_min_ = scan.angle_min;
+    angle_increment_ = scan.angle_increment;
+    cos_.resize(num_beams);
+    sin_.resize(num_beams);
+    for (unsigned int i = 0; i < num_beams; ++i) {
+      double angle = scan.angle_min + scan.angle_increment * i;
+      cos_[i] = std::cos(angle);
+      sin_[i] = std::sin(angle);
+    }
+  }
+
+  void ScanProjector::project(const sensor_msgs::LaserScan& scan, float x, float y, float yaw) {
+    updateDirections(scan);
+    unsigned int num_beams = scan.ranges.size();
+    x_.resize(num_beams);
+    y_.resize(num_beams);
+    valid_.resize(num_beams);
+    if (num_beams == 0) {
+      return;
+    }
+
+    //a beam at angle a is rotated by yaw: (cos(a + yaw), sin(a + yaw)) = (c cy - s sy, s cy + c sy)
+    float cos_yaw = std::cos(yaw), sin_yaw = std::sin(yaw);
+    const float* ranges = &scan.ranges[0];
+    unsigned int i = 0;
+#ifdef __SSE2__
+    __m128 v_x = _mm_set1_ps(x), v_y = _mm_set1_ps(y);
+    __m128 v_cos_yaw = _mm_set1_ps(cos_yaw), v_sin_yaw = _mm_set1_ps(sin_yaw);
+    __m128 v_min = _mm_set1_ps(scan.range_min), v_max = _mm_set1_ps(scan.range_max);
+    for (; i + 4 <= num_beams; i += 4) {
+      __m128 r = _mm_loadu_ps(ranges + i);
+      __m128 c = _mm_loadu_ps(&cos_[i]);
+      __m128 s = _mm_loadu_ps(&sin_[i]);
+      __m128 dx = _mm_sub_ps(_mm_mul_ps(c, v_cos_yaw), _mm_mul_ps(s, v_sin_yaw));
+      __m128 dy = _mm_add_ps(_mm_mul_ps(s, v_cos_yaw), _mm_mul_ps(c, v_sin_yaw));
+      _mm_storeu_ps(&x_[i], _mm_add_ps(v_x, _mm_mul_ps(r, dx)));
+      _mm_storeu_ps(&y_[i], _mm_add_ps(v_y, _mm_mul_ps(r, dy)));
+      //ordered comparisons are false for NaN ranges
+      int mask = _mm_movemask_ps(_mm_and_ps(_mm_cmpge_ps(r, v_min), _mm_cmplt_ps(r, v_max)));
+      valid_[i] = mask & 1;
+      valid_[i + 1] = (mask >> 1) & 1;
+      valid_[i + 2] = (mask >> 2) & 1;
+      valid_[i + 3] = (mask >> 3) & 1;
+    }
+#endif
+    for (; i < num_beams; ++i) {
+      float r = ranges[i];
+      x_[i] = x + r * (cos_[i] * cos_yaw - sin_[i] * sin_yaw);
+      y_[i] = y + r * (sin_[i] * cos_yaw + cos_[i] * sin_yaw);
+      valid_[i] = (r >= scan.range_min) & (r < scan.range_max);
+    }
+  }
+
+};
@@ -0,0 +1,439 @@
+/*********************************************************************
+ *
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2017, Open Source Robotics Foundation, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Author: Jeeseon Kim
+ *********************************************************************/
+
+#include <dwa_local_planner2/scored_sampling_planner2.h>
+
+#include <algorithm>
+
+#include <ros/console.h>
+
+// relative slack on the best cost, so that summing the bounds in another order never prunes a better trajectory
+#define BOUND_PRUNING_TOLERANCE 1e-9
+// cost of trajectories abandoned because they cannot beat the best one, their partial cost means nothing
+#define PRUNED_COST -8.0
+// samples per block in batch mode, the deadline is checked between blocks
+#define BATCH_BLOCK_SIZE 32
+
+namespace dwa_local_planner2 {
+
+  ScoringThreadPool::ScoringThreadPool(unsigned int num_workers) :
+      num_workers_(num_workers),
+      num_tasks_(0),
+      next_task_(0),
+      pending_(0),
+      shutdown_(false)
+  {
+    for (unsigned int i = 0; i < num_workers_; ++i) {
+      workers_.create_thread(boost::bind(&ScoringThreadPool::workerLoop, this));
+    }
+  }
+
+  ScoringThreadPool::~ScoringThreadPool() {
+    {
+      boost::unique_lock<boost::mutex> lock(mutex_);
+      shutdown_ = true;
+    }
+    work_cond_.notify_all();
+    workers_.join_all();
+  }
+
+  void ScoringThreadPool::run(const boost::function<void (unsigned int)>& task, unsigned int num_tasks) {
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    task_ = task;
+    num_tasks_ = num_tasks;
+    next_task_ = 0;
+    pending_ = num_tasks;
+    work_cond_.notify_all();
+
+    // the calling thread takes part instead of idling
+    while (next_task_ < num_tasks_) {
+      unsigned int index = next_task_++;
+      lock.unlock();
+      task(index);
+      lock.lock();
+      --pending_;
+    }
+    while (pending_ > 0) {
+      done_cond_.wait(lock);
+    }
+  }
+
+  void ScoringThreadPool::workerLoop() {
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    while (!shutdown_) {
+      while (next_task_ < num_tasks_) {
+        unsigned int index = next_task_++;
+        lock.unlock();
+        task_(index);
+        lock.lock();
+        if (--pending_ == 0) {
+          done_cond_.notify_all();
+        }
+      }
+      work_cond_.wait(lock);
+    }
+  }
+
+
+  ScoredSamplingPlanner2::ScoredSamplingPlanner2(std::vector<base_local_planner::TrajectorySampleGenerator*> gen_list,
+      std::vector<base_local_planner::TrajectoryCostFunction*>& critics,
+      int max_samples) :
+      gen_list_(gen_list),
+      max_samples_(max_samples),
+      batch_scoring_(false),
+      bound_pruning_(false),
+      num_covered_(0),
+      timed_out_(false),
+      initial_best_cost_(-1)
+  {
+    setCritics(critics);
+  }
+
+  void ScoredSamplingPlanner2::setCritics(std::vector<base_local_planner::TrajectoryCostFunction*>& critics) {
+    critics_ = critics;
+    batch_critics_.clear();
+    adapters_.clear();
+    bounded_critics_.clear();
+    for (unsigned int i = 0; i < critics_.size(); ++i) {
+      bounded_critics_.push_back(dynamic_cast<base_local_planner::BoundedCostFunction*>(critics_[i]));
+
+      base_local_planner::BatchCostFunction* batch_critic = dynamic_cast<base_local_planner::BatchCostFunction*>(critics_[i]);
+      if (batch_critic == NULL) {
+        adapters_.push_back(boost::shared_ptr<base_local_planner::BatchCostFunctionAdapter>(
+            new base_local_planner::BatchCostFunctionAdapter(critics_[i])));
+        batch_critic = adapters_.back().get();
+      }
+      batch_critics_.push_back(batch_critic);
+    }
+  }
+
+  void ScoredSamplingPlanner2::setThreads(unsigned int num_threads) {
+    if (num_threads <= 1) {
+      pool_.reset();
+    } else if (!pool_ || pool_->size() != num_threads) {
+      pool_.reset(new ScoringThreadPool(num_threads - 1));
+    }
+  }
+
+  double ScoredSamplingPlanner2::scoreTrajectory(base_local_planner::Trajectory& traj, double best_traj_cost) {
+    unsigned int evaluations = 0;
+    return scoreTrajectory(traj, best_traj_cost, evaluations);
+  }
+
+  double ScoredSamplingPlanner2::scoreTrajectory(base_local_planner::Trajectory& traj, double best_traj_cost,
+      unsigned int& evaluations) {
+    // remaining[i] is a lower bound of the scaled cost critics i, i + 1, ... will still add
+    std::vector<double> remaining;
+    if (bound_pruning_ && best_traj_cost > 0) {
+      remaining.assign(critics_.size() + 1, 0.0);
+      for (int i = critics_.size() - 1; i >= 0; --i) {
+        remaining[i] = remaining[i + 1];
+        double scale = critics_[i]->getScale();
+        if (bounded_critics_[i] != NULL && scale > 0) {
+          double bound = bounded_critics_[i]->costLowerBound(traj);
+          if (bound > 0) {
+            remaining[i] += bound * scale;
+          }
+        }
+      }
+    }
+
+    double traj_cost = 0;
+    int gen_id = 0;
+    for (unsigned int i = 0; i < critics_.size(); ++i) {
+      base_local_planner::TrajectoryCostFunction* score_function_p = critics_[i];
+      if (score_function_p->getScale() == 0) {
+        continue;
+      }
+      if (!remaining.empty() && traj_cost + remaining[i] > best_traj_cost * (1.0 + BOUND_PRUNING_TOLERANCE)) {
+        // cannot become better than the best any more
+        traj_cost = PRUNED_COST;
+        break;
+      }
+      double cost = score_function_p->scoreTrajectory(traj);
+      evaluations++;
+      if (cost < 0) {
+        ROS_DEBUG("Velocity %.3lf, %.3lf, %.3lf discarded by cost function %d with cost: %f",
+            traj.xv_, traj.yv_, traj.thetav_, gen_id, cost);
+        traj_cost = cost;
+        break;
+      }
+      if (cost != 0) {
+        cost *= score_function_p->getScale();
+      }
+      traj_cost += cost;
+      if (best_traj_cost > 0) {
+        // since we keep adding positives, once we are worse than the best, we will stay worse
+        if (traj_cost > best_traj_cost) {
+          traj_cost = PRUNED_COST;
+          break;
+        }
+      }
+      gen_id++;
+    }
+    return traj_cost;
+  }
+
+  unsigned int ScoredSamplingPlanner2::scoreRange(unsigned int begin, unsigned int end, unsigned int stride) {
+    double best_traj_cost = initial_best_cost_;
+    unsigned int evaluations = 0;
+    for (unsigned int i = begin; i < end; i += stride) {
+      if (deadlineExpired()) {
+        break;
+      }
+      double cost = scoreTrajectory(samples_[i], best_traj_cost, evaluations);
+      sample_costs_[i] = cost;
+      sample_scored_[i] = 1;
+      if (cost >= 0 && (best_traj_cost < 0 || cost < best_traj_cost)) {
+        best_traj_cost = cost;
+      }
+    }
+    return evaluations;
+  }
+
+  unsigned int ScoredSamplingPlanner2::scoreRangeBatch(unsigned int begin, unsigned int end) {
+    unsigned int evaluations = 0;
+    std::vector<unsigned int> legal, still_legal;
+    std::vector<double> totals(end - begin, 0.0);
+    std::vector<double> costs;
+    for (unsigned int i = begin; i < end; ++i) {
+      legal.push_back(i);
+    }
+
+    for (unsigned int c = 0; c < critics_.size() && !legal.empty(); ++c) {
+      double scale = critics_[c]->getScale();
+      if (scale == 0) {
+        continue;
+      }
+      batch_critics_[c]->scoreTrajectories(samples_, legal, costs);
+      evaluations += legal.size();
+
+      // accumulate exactly as scoreTrajectory() does, so full costs are identical
+      still_legal.clear();
+      for (unsigned int k = 0; k < legal.size(); ++k) {
+        double cost = costs[k];
+        if (cost < 0) {
+          sample_costs_[legal[k]] = cost;
+          continue;
+        }
+        if (cost != 0) {
+          cost *= scale;
+        }
+        totals[legal[k] - begin] += cost;
+        still_legal.push_back(legal[k]);
+      }
+      legal.swap(still_legal);
+    }
+
+    for (unsigned int k = 0; k < legal.size(); ++k) {
+      sample_costs_[legal[k]] = totals[legal[k] - begin];
+    }
+    for (unsigned int i = begin; i < end; ++i) {
+      sample_scored_[i] = 1;
+    }
+    return evaluations;
+  }
+
+  void ScoredSamplingPlanner2::scoreChunk(unsigned int chunk, unsigned int num_chunks) {
+    unsigned int n = samples_.size();
+    if (batch_scoring_) {
+      // blocks are dealt out in turn like single samples, and a block is only complete once all
+      // critics are done, so it is scored entirely or not at all
+      unsigned int evaluations = 0;
+      for (unsigned int begin = chunk * BATCH_BLOCK_SIZE; begin < n; begin += num_chunks * BATCH_BLOCK_SIZE) {
+        if (deadlineExpired()) {
+          break;
+        }
+        evaluations += scoreRangeBatch(begin, std::min(n, begin + BATCH_BLOCK_SIZE));
+      }
+      chunk_evaluations_[chunk] = evaluations;
+    } else {
+      // samples are dealt out in turn, so all threads work on the first samples first
+      chunk_evaluations_[chunk] = scoreRange(chunk, n, num_chunks);
+    }
+  }
+
+  bool ScoredSamplingPlanner2::findBestTrajectory(base_local_planner::Trajectory& traj,
+      std::vector<base_local_planner::Trajectory>* all_explored) {
+    if (prepareCritics() == false) {
+      return false;
+    }
+    return searchBestTrajectory(traj, all_explored);
+  }
+
+  bool ScoredSamplingPlanner2::prepareCritics() {
+    for (std::vector<base_local_planner::TrajectoryCostFunction*>::iterator loop_critic = critics_.begin();
+        loop_critic != critics_.end(); ++loop_critic) {
+      base_local_planner::TrajectoryCostFunction* loop_critic_p = *loop_critic;
+      if (loop_critic_p->prepare() == false) {
+        ROS_WARN("A scoring function failed to prepare");
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool ScoredSamplingPlanner2::searchBestTrajectory(base_local_planner::Trajectory& traj,
+      std::vector<base_local_planner::Trajectory>* all_explored, double best_cost) {
+    base_local_planner::Trajectory loop_traj;
+    base_local_planner::Trajectory best_traj;
+    double loop_traj_cost, best_traj_cost = best_cost;
+    bool found = false;
+    bool gen_success;
+    int count, count_valid;
+    unsigned int evaluations;
+    num_covered_ = 0;
+    timed_out_ = false;
+    for (std::vector<base_local_planner::TrajectorySampleGenerator*>::iterator loop_gen = gen_list_.begin();
+        loop_gen != gen_list_.end(); ++loop_gen) {
+      count = 0;
+      count_valid = 0;
+      evaluations = 0;
+      base_local_planner::TrajectorySampleGenerator* gen_ = *loop_gen;
+
+      if (pool_ || batch_scoring_) {
+        // generators are stateful, so sampling stays on this thread
+        samples_.clear();
+        while (gen_->hasMoreTrajectories()) {
+          if (deadlineExpired()) {
+            timed_out_ = true;
+            break;
+          }
+          if (!gen_->nextTrajectory(loop_traj)) {
+            num_covered_++;
+            continue;
+          }
+          samples_.push_back(loop_traj);
+          if (max_samples_ > 0 && (int)samples_.size() >= max_samples_) {
+            break;
+          }
+        }
+        sample_costs_.resize(samples_.size());
+        sample_scored_.assign(samples_.size(), 0);
+        initial_best_cost_ = best_cost;
+
+        unsigned int num_chunks = std::min<unsigned int>(pool_ ? pool_->size() : 1, samples_.size());
+        chunk_evaluations_.assign(num_chunks, 0);
+        if (num_chunks > 1) {
+          pool_->run(boost::bind(&ScoredSamplingPlanner2::scoreChunk, this, _1, num_chunks), num_chunks);
+        } else if (num_chunks == 1) {
+          scoreChunk(0, 1);
+        }
+        for (unsigned int i = 0; i < num_chunks; ++i) {
+          evaluations += chunk_evaluations_[i];
+        }
+
+        // reduce in sample order, the first of equal costs wins as in the serial loop
+        int best_index = -1;
+        for (unsigned int i = 0; i < samples_.size(); ++i) {
+          if (!sample_scored_[i]) {
+            // cut off by the deadline
+            timed_out_ = true;
+            continue;
+          }
+          num_covered_++;
+          if (all_explored != NULL) {
+            samples_[i].cost_ = sample_costs_[i];
+            all_explored->push_back(samples_[i]);
+          }
+          if (sample_costs_[i] >= 0) {
+            count_valid++;
+            if (best_traj_cost < 0 || sample_costs_[i] < best_traj_cost) {
+              best_traj_cost = sample_costs_[i];
+              best_index = i;
+            }
+          }
+          count++;
+        }
+        if (best_index >= 0) {
+          best_traj = samples_[best_index];
+          found = true;
+        }
+      } else {
+        while (gen_->hasMoreTrajectories()) {
+          if (deadlineExpired()) {
+            timed_out_ = true;
+            break;
+          }
+          gen_success = gen_->nextTrajectory(loop_traj);
+          num_covered_++;
+          if (gen_success == false) {
+            // TODO use this for debugging
+            continue;
+          }
+          loop_traj_cost = scoreTrajectory(loop_traj, best_traj_cost, evaluations);
+          if (all_explored != NULL) {
+            loop_traj.cost_ = loop_traj_cost;
+            all_explored->push_back(loop_traj);
+          }
+
+          if (loop_traj_cost >= 0) {
+            count_valid++;
+            if (best_traj_cost < 0 || loop_traj_cost < best_traj_cost) {
+              best_traj_cost = loop_traj_cost;
+              best_traj = loop_traj;
+              found = true;
+            }
+          }
+          count++;
+          if (max_samples_ > 0 && count >= max_samples_) {
+            break;
+          }
+        }
+      }
+
+      if (found) {
+        traj.xv_ = best_traj.xv_;
+        traj.yv_ = best_traj.yv_;
+        traj.thetav_ = best_traj.thetav_;
+        traj.cost_ = best_traj_cost;
+        traj.resetPoints();
+        double px, py, pth;
+        for (unsigned int i = 0; i < best_traj.getPointsSize(); i++) {
+          best_traj.getPoint(i, px, py, pth);
+          traj.addPoint(px, py, pth);
+        }
+      }
+      ROS_DEBUG("Evaluated %d trajectories, found %d valid, %u critic evaluations", count, count_valid, evaluations);
+      if (found || timed_out_) {
+        // do not try fallback generators
+        break;
+      }
+    }
+    return found;
+  }
+};
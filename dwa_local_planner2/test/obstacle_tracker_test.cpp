@@ -0,0 +1,133 @@
+/*
+ * obstacle_tracker_test.cpp
+ *
+ *      Author: Jeeseon Kim
+ */
+
+#include <gtest/gtest.h>
+
+#include <utility>
+#include <vector>
+
+#include <dwa_local_planner2/obstacle_tracker.h>
+
+namespace dwa_local_planner2 {
+
+namespace {
+
+typedef std::vector<std::pair<float, float> > Detections;
+
+const double DT = 0.1;
+
+}
+
+TEST(ObstacleTrackerTest, constantVelocityEstimate) {
+  ObstacleTracker tracker(0.5, 2);
+  std::vector<int> assoc;
+  for (int k = 0; k < 10; ++k) {
+    Detections detections(1, std::make_pair(1.0f + 0.5f * k * DT, 2.0f - 0.2f * k * DT));
+    tracker.update(detections, k == 0 ? 0.0 : DT, assoc);
+    ASSERT_EQ(1u, tracker.getTracks().size());
+    ASSERT_EQ(0, assoc[0]);
+    const ObstacleTracker::Track& track = tracker.getTracks()[0];
+    EXPECT_EQ(0u, track.id);
+    EXPECT_EQ(k + 1u, track.age);
+    EXPECT_EQ(0u, track.missed);
+    if (k == 0) {
+      // new tracks start at rest
+      EXPECT_EQ(0.0f, track.vx);
+      EXPECT_EQ(0.0f, track.vy);
+    } else {
+      EXPECT_NEAR(0.5, track.vx, 1e-4);
+      EXPECT_NEAR(-0.2, track.vy, 1e-4);
+    }
+  }
+}
+
+TEST(ObstacleTrackerTest, crossingTracksKeepTheirIds) {
+  ObstacleTracker tracker(0.5, 2);
+  std::vector<int> assoc;
+  unsigned int ids[2];
+  for (int k = 0; k <= 20; ++k) {
+    // head on along y = 0 and y = 0.2, passing each other after a second
+    Detections detections;
+    detections.push_back(std::make_pair(0.0f + 1.0f * k * DT, 0.0f));
+    detections.push_back(std::make_pair(2.0f - 1.0f * k * DT, 0.2f));
+    tracker.update(detections, k == 0 ? 0.0 : DT, assoc);
+    ASSERT_EQ(2u, tracker.getTracks().size()) << "update " << k;
+    for (int d = 0; d < 2; ++d) {
+      const ObstacleTracker::Track& track = tracker.getTracks()[assoc[d]];
+      if (k == 0) {
+        ids[d] = track.id;
+      }
+      EXPECT_EQ(ids[d], track.id) << "update " << k << " detection " << d;
+      if (k > 0) {
+        EXPECT_NEAR(d == 0 ? 1.0 : -1.0, track.vx, 1e-4) << "update " << k << " detection " << d;
+      }
+    }
+  }
+  EXPECT_NE(ids[0], ids[1]);
+}
+
+TEST(ObstacleTrackerTest, tracksMoreThanTenObstacles) {
+  ObstacleTracker tracker(0.5, 2);
+  std::vector<int> assoc;
+  std::vector<unsigned int> ids;
+  const int num_obstacles = 60;
+  for (int k = 0; k < 5; ++k) {
+    Detections detections;
+    for (int i = 0; i < num_obstacles; ++i) {
+      // a 1m grid, each obstacle with its own velocity
+      float vx = 0.1f * (i % 5) - 0.2f, vy = 0.1f * (i % 3) - 0.1f;
+      detections.push_back(std::make_pair((i % 10) + vx * float(k * DT), (i / 10) + vy * float(k * DT)));
+    }
+    tracker.update(detections, k == 0 ? 0.0 : DT, assoc);
+    ASSERT_EQ(unsigned(num_obstacles), tracker.getTracks().size());
+    for (int i = 0; i < num_obstacles; ++i) {
+      ASSERT_GE(assoc[i], 0);
+      const ObstacleTracker::Track& track = tracker.getTracks()[assoc[i]];
+      if (k == 0) {
+        ids.push_back(track.id);
+      }
+      EXPECT_EQ(ids[i], track.id) << "update " << k << " obstacle " << i;
+      if (k > 0) {
+        EXPECT_NEAR(0.1 * (i % 5) - 0.2, track.vx, 1e-3) << "obstacle " << i;
+        EXPECT_NEAR(0.1 * (i % 3) - 0.1, track.vy, 1e-3) << "obstacle " << i;
+      }
+    }
+  }
+}
+
+TEST(ObstacleTrackerTest, expiresAfterMaxMissed) {
+  ObstacleTracker tracker(0.5, 2);
+  std::vector<int> assoc;
+  tracker.update(Detections(1, std::make_pair(0.0f, 0.0f)), 0.0, assoc);
+  tracker.update(Detections(1, std::make_pair(0.1f, 0.0f)), DT, assoc);
+  unsigned int id = tracker.getTracks()[0].id;
+
+  // unobserved tracks are predicted forward for max_missed updates
+  for (unsigned int missed = 1; missed <= 2; ++missed) {
+    tracker.update(Detections(), DT, assoc);
+    ASSERT_EQ(1u, tracker.getTracks().size());
+    EXPECT_EQ(missed, tracker.getTracks()[0].missed);
+    EXPECT_NEAR(0.1 + missed * 0.1, tracker.getTracks()[0].x, 1e-5);
+  }
+
+  // and picked up again where they are predicted
+  tracker.update(Detections(1, std::make_pair(0.4f, 0.0f)), DT, assoc);
+  ASSERT_EQ(1u, tracker.getTracks().size());
+  EXPECT_EQ(id, tracker.getTracks()[assoc[0]].id);
+  EXPECT_EQ(0u, tracker.getTracks()[0].missed);
+
+  // one update more than max_missed drops them
+  for (int k = 0; k < 3; ++k) {
+    tracker.update(Detections(), DT, assoc);
+  }
+  EXPECT_TRUE(tracker.getTracks().empty());
+  tracker.update(Detections(1, std::make_pair(0.7f, 0.0f)), DT, assoc);
+  ASSERT_EQ(1u, tracker.getTracks().size());
+  EXPECT_NE(id, tracker.getTracks()[0].id);
+  EXPECT_EQ(1u, tracker.getTracks()[0].age);
+}
+
+} /* namespace dwa_local_planner2 */
@@ -0,0 +1,139 @@
+/*
+ * safety_kernel_test.cpp
+ *
+ *      Author: Jeeseon Kim
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+
+#include <dwa_local_planner2/safety_kernel.h>
+
+namespace dwa_local_planner2 {
+
+namespace {
+
+// as in DWAPlannerROS2
+const double GAUSS_ALPHA = 0.1;
+const double SIGMA = 0.4;
+const double EPSILON = 0.0001;
+
+/**
+ * The gaussian of the angle to the obstacle, over the full turn
+ */
+double circularGaussian(int bin, int obstacle_bin, int direction_bins) {
+  int offset = abs(bin - obstacle_bin);
+  offset = std::min(offset, direction_bins - offset);
+  double degrees = offset * 360.0 / direction_bins;
+  return std::exp(-1 * (GAUSS_ALPHA * degrees) * (GAUSS_ALPHA * degrees) / (2 * SIGMA));
+}
+
+/**
+ * The largest weight the kernel leaves out, an upper bound on its error
+ */
+double firstWeightLeftOut(int direction_bins) {
+  for (int offset = 0; ; ++offset) {
+    double g = circularGaussian(offset, 0, std::max(direction_bins, 2 * offset + 1));
+    if (g < EPSILON) {
+      return g;
+    }
+  }
+}
+
+}
+
+TEST(SafetyKernelTest, sseMatchesScalar) {
+  srand(1);
+  double weights[] = {0.0, 0.3, 0.8, 1.0, std::numeric_limits<double>::quiet_NaN()};
+  for (int n = 0; n < 20; ++n) {
+    for (int w = 0; w < 5; ++w) {
+      std::vector<double> kernel(n), safety(n);
+      for (int i = 0; i < n; ++i) {
+        kernel[i] = double(rand()) / RAND_MAX;
+        safety[i] = double(rand()) / RAND_MAX;
+      }
+      std::vector<double> expected = safety;
+      lowerSafetyScalar(n > 0 ? &expected[0] : NULL, n > 0 ? &kernel[0] : NULL, n, weights[w]);
+      lowerSafety(n > 0 ? &safety[0] : NULL, n > 0 ? &kernel[0] : NULL, n, weights[w]);
+      for (int i = 0; i < n; ++i) {
+        EXPECT_EQ(expected[i], safety[i]) << "n " << n << " weight " << weights[w] << " bin " << i;
+      }
+    }
+  }
+}
+
+TEST(SafetyKernelTest, nanWeightKeepsSafety) {
+  SafetyKernel kernel;
+  kernel.build(360, GAUSS_ALPHA, SIGMA, EPSILON);
+  std::vector<double> safety(360, 1.0), probability(360 * 4, 0.0);
+  kernel.spread(10, std::numeric_limits<double>::quiet_NaN(), &safety[0], &probability[0], 4, 0);
+  for (unsigned int i = 0; i < safety.size(); ++i) {
+    EXPECT_EQ(1.0, safety[i]) << "bin " << i;
+  }
+  for (unsigned int i = 0; i < probability.size(); ++i) {
+    EXPECT_EQ(0.0, probability[i]) << "cell " << i;
+  }
+}
+
+TEST(SafetyKernelTest, matchesCircularGaussian) {
+  srand(1);
+  int direction_bins[] = {1, 2, 10, 57, 60, 360, 720};
+  for (int d = 0; d < 7; ++d) {
+    int num_bins = direction_bins[d];
+    SafetyKernel kernel;
+    kernel.build(num_bins, GAUSS_ALPHA, SIGMA, EPSILON);
+    double tolerance = firstWeightLeftOut(num_bins);
+    EXPECT_LT(tolerance, EPSILON);
+    for (int trial = 0; trial < 200; ++trial) {
+      int num_obstacles = rand() % 5;
+      std::vector<int> bins(num_obstacles);
+      std::vector<double> weights(num_obstacles);
+      std::vector<double> safety(num_bins, 1.0);
+      for (int j = 0; j < num_obstacles; ++j) {
+        bins[j] = rand() % num_bins;
+        weights[j] = (rand() % 1000) / 1000.0;
+        kernel.spread(bins[j], weights[j], &safety[0]);
+      }
+      for (int i = 0; i < num_bins; ++i) {
+        double expected = 1.0;
+        for (int j = 0; j < num_obstacles; ++j) {
+          expected = std::min(expected, 1 - circularGaussian(i, bins[j], num_bins) * weights[j]);
+        }
+        // the bins left out of the kernel would be lowered by less than EPSILON
+        EXPECT_GE(safety[i], expected) << num_bins << " bins, bin " << i;
+        EXPECT_LE(safety[i], expected + tolerance) << num_bins << " bins, bin " << i;
+      }
+    }
+  }
+  // 28 degrees out at one degree bins
+  EXPECT_NEAR(std::exp(-9.8), firstWeightLeftOut(360), 1e-12);
+}
+
+TEST(SafetyKernelTest, spreadsPolarProbability) {
+  const int num_bins = 360, range_bins = 40;
+  SafetyKernel kernel;
+  kernel.build(num_bins, GAUSS_ALPHA, SIGMA, EPSILON);
+  std::vector<double> safety(num_bins, 1.0), probability(num_bins * range_bins, 0.0);
+  // an obstacle just above the first bin, so that it wraps around
+  kernel.spread(1, 0.6, &safety[0], &probability[0], range_bins, 12);
+  std::vector<double> near_safety = safety;
+  // one beyond the last range only lowers the safety
+  kernel.spread(200, 0.3, &safety[0], &probability[0], range_bins, 50);
+  for (int i = 0; i < num_bins; ++i) {
+    for (int r = 0; r < range_bins; ++r) {
+      double expected = r < 12 ? 0.0 : 1 - near_safety[i];
+      EXPECT_NEAR(expected, probability[i * range_bins + r], 1e-12) << "bin " << i << " range " << r;
+    }
+  }
+  EXPECT_DOUBLE_EQ(0.4, safety[1]);
+  EXPECT_DOUBLE_EQ(0.7, safety[200]);
+  EXPECT_LT(safety[num_bins - 1], 1.0);
+  EXPECT_GT(probability[(num_bins - 1) * range_bins + 12], 0.0);
+}
+
+} /* namespace dwa_local_planner2 */
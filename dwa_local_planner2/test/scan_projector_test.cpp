@@ -0,0 +1,90 @@
+/*
+ * scan_projector_test.cpp
+ *
+ *      Author: Jeeseon Kim
+ */
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+#include <dwa_local_planner2/scan_projector.h>
+
+namespace dwa_local_planner2 {
+
+namespace {
+
+/**
+ * A full turn of beams with NaN, too short, too long and valid ranges
+ */
+sensor_msgs::LaserScan makeScan(unsigned int num_beams) {
+  sensor_msgs::LaserScan scan;
+  scan.angle_min = -M_PI;
+  scan.angle_increment = 2 * M_PI / num_beams;
+  scan.range_min = 0.1;
+  scan.range_max = 10.0;
+  srand(1);
+  for (unsigned int i = 0; i < num_beams; ++i) {
+    float range;
+    if (i % 17 == 0) {
+      range = std::numeric_limits<float>::quiet_NaN();
+    } else if (i % 13 == 0) {
+      range = 0.05;
+    } else if (i % 11 == 0) {
+      range = 10.0;
+    } else {
+      range = 0.1 + (rand() % 1000) / 100.0;
+    }
+    scan.ranges.push_back(range);
+  }
+  return scan;
+}
+
+}
+
+TEST(ScanProjectorTest, matchesPerBeamTrig) {
+  sensor_msgs::LaserScan scan = makeScan(721);
+  ScanProjector projector;
+  for (int k = 0; k < 100; ++k) {
+    float x = k * 0.1, y = -k * 0.05, yaw = k * 0.3 - 10;
+    projector.project(scan, x, y, yaw);
+    ASSERT_EQ(scan.ranges.size(), projector.getX().size());
+    ASSERT_EQ(scan.ranges.size(), projector.getY().size());
+    for (unsigned int i = 0; i < scan.ranges.size(); ++i) {
+      float range = scan.ranges[i];
+      bool valid = range >= scan.range_min && range < scan.range_max;
+      EXPECT_EQ(valid, projector.isValid(i)) << "beam " << i << " range " << range;
+      if (valid) {
+        double angle = scan.angle_min + scan.angle_increment * i + yaw;
+        EXPECT_NEAR(x + range * cos(angle), projector.getX()[i], 1e-5) << "beam " << i;
+        EXPECT_NEAR(y + range * sin(angle), projector.getY()[i], 1e-5) << "beam " << i;
+      }
+    }
+  }
+}
+
+TEST(ScanProjectorTest, followsScanGeometryChanges) {
+  ScanProjector projector;
+  projector.project(makeScan(721), 0.0, 0.0, 0.0);
+
+  // fewer beams over a narrower field of view, not a multiple of four
+  sensor_msgs::LaserScan scan = makeScan(181);
+  scan.angle_min = -M_PI / 2;
+  scan.angle_increment = M_PI / 180;
+  projector.project(scan, 1.0, 2.0, 0.5);
+  ASSERT_EQ(181u, projector.getX().size());
+  for (unsigned int i = 0; i < scan.ranges.size(); ++i) {
+    if (projector.isValid(i)) {
+      double angle = scan.angle_min + scan.angle_increment * i + 0.5;
+      EXPECT_NEAR(1.0 + scan.ranges[i] * cos(angle), projector.getX()[i], 1e-5) << "beam " << i;
+      EXPECT_NEAR(2.0 + scan.ranges[i] * sin(angle), projector.getY()[i], 1e-5) << "beam " << i;
+    }
+  }
+  EXPECT_FALSE(projector.isValid(0));
+  EXPECT_FALSE(projector.isValid(13));
+  EXPECT_FALSE(projector.isValid(11));
+}
+
+} /* namespace dwa_local_planner2 */
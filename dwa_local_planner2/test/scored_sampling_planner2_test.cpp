@@ -0,0 +1,178 @@
+/*
+ * scored_sampling_planner2_test.cpp
+ *
+ *      Author: Jeeseon Kim
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <vector>
+
+#include <dwa_local_planner2/scored_sampling_planner2.h>
+
+namespace dwa_local_planner2 {
+
+namespace {
+
+/**
+ * Yields trajectories whose xv_ is their index, as often as it is rewound
+ */
+class IndexGenerator : public base_local_planner::TrajectorySampleGenerator {
+  public:
+    IndexGenerator(unsigned int num_samples) : num_samples_(num_samples), next_(0) {}
+
+    void rewind() { next_ = 0; }
+
+    bool hasMoreTrajectories() { return next_ < num_samples_; }
+
+    bool nextTrajectory(base_local_planner::Trajectory& traj) {
+      traj.resetPoints();
+      traj.xv_ = next_++;
+      traj.yv_ = 0.0;
+      traj.thetav_ = 0.0;
+      traj.addPoint(traj.xv_, 0.0, 0.0);
+      return true;
+    }
+
+  private:
+    unsigned int num_samples_, next_;
+};
+
+/**
+ * Costs looked up by the index of the trajectory
+ */
+class TableCritic : public base_local_planner::TrajectoryCostFunction {
+  public:
+    TableCritic(const std::vector<double>& costs, double scale) :
+        base_local_planner::TrajectoryCostFunction(scale), costs_(costs) {}
+
+    bool prepare() { return true; }
+
+    double scoreTrajectory(base_local_planner::Trajectory& traj) { return costs_[int(traj.xv_)]; }
+
+  protected:
+    std::vector<double> costs_;
+};
+
+/**
+ * Costs looked up by the index of the trajectory, with a lower bound that is a fraction of them
+ */
+class BoundedTableCritic : public TableCritic, public base_local_planner::BoundedCostFunction {
+  public:
+    BoundedTableCritic(const std::vector<double>& costs, double scale, double bound_fraction) :
+        TableCritic(costs, scale), bound_fraction_(bound_fraction) {}
+
+    double costLowerBound(base_local_planner::Trajectory& traj) { return bound_fraction_ * costs_[int(traj.xv_)]; }
+
+  private:
+    double bound_fraction_;
+};
+
+/**
+ * Small integer costs, so that many trajectories tie, and some rejected ones
+ */
+std::vector<double> randomCosts(unsigned int num_samples, int max_cost, int reject_one_in) {
+  std::vector<double> costs(num_samples);
+  for (unsigned int i = 0; i < num_samples; ++i) {
+    costs[i] = rand() % reject_one_in == 0 ? -1.0 : 1 + rand() % max_cost;
+  }
+  return costs;
+}
+
+}
+
+TEST(ScoredSamplingPlanner2Test, threadsChooseTheSerialTrajectory) {
+  const unsigned int num_samples = 300;
+  for (unsigned int seed = 1; seed <= 20; ++seed) {
+    srand(seed);
+    TableCritic first(randomCosts(num_samples, 4, 10), 1.0);
+    TableCritic second(randomCosts(num_samples, 3, 20), 2.0);
+    std::vector<base_local_planner::TrajectoryCostFunction*> critics;
+    critics.push_back(&first);
+    critics.push_back(&second);
+    IndexGenerator generator(num_samples);
+    std::vector<base_local_planner::TrajectorySampleGenerator*> generators(1, &generator);
+    ScoredSamplingPlanner2 planner(generators, critics);
+
+    // the first trajectory of the lowest cost, as the serial loop finds it
+    int expected_index = -1;
+    double expected_cost = -1;
+    for (unsigned int i = 0; i < num_samples; ++i) {
+      base_local_planner::Trajectory traj;
+      traj.xv_ = i;
+      double a = first.scoreTrajectory(traj), b = second.scoreTrajectory(traj);
+      if (a >= 0 && b >= 0 && (expected_cost < 0 || a + 2 * b < expected_cost)) {
+        expected_cost = a + 2 * b;
+        expected_index = i;
+      }
+    }
+    ASSERT_GE(expected_index, 0);
+
+    unsigned int thread_counts[] = {1, 2, 3, 4, 8};
+    for (int t = 0; t < 5; ++t) {
+      for (int batch = 0; batch < 2; ++batch) {
+        planner.setThreads(thread_counts[t]);
+        planner.setBatchScoring(batch);
+        generator.rewind();
+        base_local_planner::Trajectory traj;
+        ASSERT_TRUE(planner.findBestTrajectory(traj));
+        EXPECT_EQ(expected_index, int(traj.xv_)) << "seed " << seed << " threads " << thread_counts[t] << " batch " << batch;
+        EXPECT_EQ(expected_cost, traj.cost_) << "seed " << seed << " threads " << thread_counts[t] << " batch " << batch;
+        EXPECT_EQ(num_samples, planner.getNumCovered());
+      }
+    }
+  }
+}
+
+TEST(ScoredSamplingPlanner2Test, boundPruningChoosesTheExhaustiveTrajectory) {
+  const unsigned int num_samples = 300;
+  unsigned int pruned = 0;
+  for (unsigned int seed = 1; seed <= 20; ++seed) {
+    srand(seed);
+    // fractional costs, so that the bounds and the running costs are summed with different rounding
+    std::vector<double> first_costs = randomCosts(num_samples, 40, 10), exact_costs = randomCosts(num_samples, 40, 20);
+    std::vector<double> half_costs = randomCosts(num_samples, 40, 20);
+    for (unsigned int i = 0; i < num_samples; ++i) {
+      first_costs[i] *= 0.1;
+      exact_costs[i] *= 0.3;
+      half_costs[i] *= 0.7;
+    }
+    TableCritic first(first_costs, 1.0);
+    // a bound that equals the cost, one that is half of it and one that is no help
+    BoundedTableCritic exact(exact_costs, 0.5, 1.0);
+    BoundedTableCritic half(half_costs, 2.0, 0.5);
+    BoundedTableCritic none(first_costs, 0.2, 0.0);
+    std::vector<base_local_planner::TrajectoryCostFunction*> critics;
+    critics.push_back(&first);
+    critics.push_back(&exact);
+    critics.push_back(&half);
+    critics.push_back(&none);
+    IndexGenerator generator(num_samples);
+    std::vector<base_local_planner::TrajectorySampleGenerator*> generators(1, &generator);
+    ScoredSamplingPlanner2 planner(generators, critics);
+
+    unsigned int thread_counts[] = {1, 3};
+    for (int t = 0; t < 2; ++t) {
+      planner.setThreads(thread_counts[t]);
+      planner.setBoundPruning(false);
+      generator.rewind();
+      base_local_planner::Trajectory expected;
+      ASSERT_TRUE(planner.findBestTrajectory(expected));
+
+      planner.setBoundPruning(true);
+      generator.rewind();
+      base_local_planner::Trajectory traj;
+      std::vector<base_local_planner::Trajectory> explored;
+      ASSERT_TRUE(planner.findBestTrajectory(traj, &explored));
+      EXPECT_EQ(expected.xv_, traj.xv_) << "seed " << seed << " threads " << thread_counts[t];
+      EXPECT_EQ(expected.cost_, traj.cost_) << "seed " << seed << " threads " << thread_counts[t];
+      for (unsigned int i = 0; i < explored.size(); ++i) {
+        pruned += explored[i].cost_ == -8.0;
+      }
+    }
+  }
+  EXPECT_GT(pruned, 0u);
+}
+
+} /* namespace dwa_local_planner2 */